@@ -0,0 +1,110 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+/*
+ * helpers shared by the benches in bench/, each of which is its own
+ * executable run by `zig build bench`. build with -Drelease-fast for numbers
+ * worth comparing.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <time.h>
+#include <sys/resource.h>
+
+#include "fungus.h"
+
+static inline double bench_now(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+// peak resident memory of the process so far, in KiB
+static inline long bench_peak_kib(void) {
+    struct rusage usage;
+
+    getrusage(RUSAGE_SELF, &usage);
+
+    return usage.ru_maxrss;
+}
+
+// best time of `runs` calls to `fn`, in ms
+static inline double bench_best_ms(void (*fn)(void *), void *ctx, int runs) {
+    double best = 0.0;
+
+    for (int i = 0; i < runs; ++i) {
+        double start = bench_now();
+
+        fn(ctx);
+
+        double elapsed = (bench_now() - start) * 1e3;
+
+        if (i == 0 || elapsed < best)
+            best = elapsed;
+    }
+
+    return best;
+}
+
+// sets up types, names and langs the way main does
+static inline void bench_init(Names *names) {
+    words_init();
+    types_init();
+    names_init();
+    *names = Names_new();
+    fungus_define_base(names);
+    pattern_lang_init(names);
+    fungus_lang_init(names);
+}
+
+static inline void bench_quit(Names *names) {
+    fungus_lang_quit();
+    pattern_lang_quit();
+    Names_del(names);
+    names_quit();
+    types_quit();
+    words_quit();
+}
+
+// a file owning the text from a buffer built with bench_text_*
+static inline File bench_file(const char *name, char *text, size_t len) {
+    File file = File_from_str(name, text, len);
+
+    file.owns_text = true;
+
+    return file;
+}
+
+// growable text buffer for generating sources
+typedef struct BenchText {
+    char *str;
+    size_t len, cap;
+} BenchText;
+
+static inline void bench_text_printf(BenchText *text, const char *fmt, ...) {
+    va_list args;
+
+    while (true) {
+        if (text->cap > text->len) {
+            va_start(args, fmt);
+            int n = vsnprintf(text->str + text->len, text->cap - text->len, fmt,
+                              args);
+            va_end(args);
+
+            if (text->len + n < text->cap) {
+                text->len += n;
+                return;
+            }
+        }
+
+        text->cap = text->cap ? text->cap * 2 : 4096;
+        text->str = realloc(text->str, text->cap);
+    }
+}
+
+#endif
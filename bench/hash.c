@@ -0,0 +1,137 @@
+#include "bench.h"
+
+/*
+ * word_hash against the byte at a time fnv_hash it replaced for Words:
+ * throughput over a few key lengths, time per identifier, and the average
+ * probe length of a linear probed table like the word interner's.
+ */
+
+#define NUM_IDENTS 100000
+#define RUNS 7
+
+typedef hash_t (*HashFn)(const char *data, size_t nbytes);
+
+typedef struct HashBench {
+    HashFn fn;
+    const char *data;
+    size_t len, reps;
+
+    const View *idents;
+    size_t num_idents;
+
+    hash_t sink;
+} HashBench;
+
+static void hash_block(void *ctx) {
+    HashBench *hb = ctx;
+
+    for (size_t i = 0; i < hb->reps; ++i)
+        hb->sink ^= hb->fn(hb->data, hb->len);
+}
+
+static void hash_idents(void *ctx) {
+    HashBench *hb = ctx;
+
+    for (size_t i = 0; i < hb->num_idents; ++i)
+        hb->sink ^= hb->fn(hb->idents[i].str, hb->idents[i].len);
+}
+
+// average slots looked at per lookup, with every ident inserted
+static double probe_len(HashFn fn, const View *idents, size_t n, size_t cap) {
+    bool *used = calloc(cap, sizeof(*used));
+    size_t probes = 0;
+
+    for (size_t i = 0; i < n; ++i) {
+        size_t idx = fn(idents[i].str, idents[i].len) & (cap - 1);
+
+        for (++probes; used[idx]; ++probes)
+            idx = (idx + 1) & (cap - 1);
+
+        used[idx] = true;
+    }
+
+    free(used);
+
+    return (double)probes / (double)n;
+}
+
+int main(void) {
+    const struct { const char *name; HashFn fn; } fns[] = {
+        { "fnv_hash ", fnv_hash },
+        { "word_hash", word_hash },
+    };
+    const size_t lens[] = { 8, 32, 4096 };
+
+    // identifiers of mixed length, like a large source file's
+    const char *stems[] = { "i", "x", "len", "index", "node_count",
+                            "parse_scope_matches", "a_much_longer_name_" };
+    BenchText text = {0};
+    size_t *ends = malloc(NUM_IDENTS * sizeof(*ends));
+
+    for (size_t i = 0; i < NUM_IDENTS; ++i) {
+        bench_text_printf(&text, "%s%zu", stems[i % ARRAY_SIZE(stems)], i);
+        ends[i] = text.len;
+    }
+
+    View *idents = malloc(NUM_IDENTS * sizeof(*idents));
+
+    for (size_t i = 0; i < NUM_IDENTS; ++i) {
+        size_t start = i ? ends[i - 1] : 0;
+
+        idents[i] = (View){ &text.str[start], ends[i] - start };
+    }
+
+    char *block = malloc(lens[ARRAY_SIZE(lens) - 1]);
+
+    for (size_t i = 0; i < lens[ARRAY_SIZE(lens) - 1]; ++i)
+        block[i] = (char)('a' + i % 26);
+
+    puts("hash throughput:");
+
+    for (size_t i = 0; i < ARRAY_SIZE(lens); ++i) {
+        for (size_t j = 0; j < ARRAY_SIZE(fns); ++j) {
+            HashBench hb = {
+                .fn = fns[j].fn,
+                .data = block,
+                .len = lens[i],
+                .reps = (64 * 1024 * 1024) / lens[i]
+            };
+            double ms = bench_best_ms(hash_block, &hb, RUNS);
+            double gbps = (double)(hb.len * hb.reps) / (ms * 1e6);
+
+            printf("  len %4zu %s %6.2f GB/s\n", lens[i], fns[j].name, gbps);
+        }
+    }
+
+    printf("%d identifiers:\n", NUM_IDENTS);
+
+    for (size_t j = 0; j < ARRAY_SIZE(fns); ++j) {
+        HashBench hb = {
+            .fn = fns[j].fn,
+            .idents = idents,
+            .num_idents = NUM_IDENTS
+        };
+        double ms = bench_best_ms(hash_idents, &hb, RUNS);
+
+        printf("  %s %6.2f ns per word\n", fns[j].name,
+               ms * 1e6 / NUM_IDENTS);
+    }
+
+    puts("linear probe length:");
+
+    for (size_t cap = 1 << 18; cap >= 1 << 17; cap /= 2) {
+        double load = (double)NUM_IDENTS / (double)cap;
+
+        for (size_t j = 0; j < ARRAY_SIZE(fns); ++j) {
+            printf("  load %.2f %s %6.3f\n", load, fns[j].name,
+                   probe_len(fns[j].fn, idents, NUM_IDENTS, cap));
+        }
+    }
+
+    free(block);
+    free(idents);
+    free(ends);
+    free(text.str);
+
+    return 0;
+}
@@ -0,0 +1,255 @@
+#include "bench.h"
+
+/*
+ * IdMap against the chained map it replaced, on interned names: putting every
+ * name into an empty map, then looking each one up, then looking up names
+ * that were never put. both compare words with Word_eq, so this only measures
+ * the table layout.
+ */
+
+#define NUM_NAMES 100000
+#define SMALL_NAMES 64
+#define RUNS 7
+
+// the chained IdMap, one malloc'd node per entry =============================
+
+typedef struct ChainNode {
+    struct ChainNode *next;
+
+    const Word *name;
+    unsigned id;
+} ChainNode;
+
+typedef struct ChainMap {
+    ChainNode **nodes;
+    size_t size, cap;
+} ChainMap;
+
+static ChainMap ChainMap_new(void) {
+    return (ChainMap){
+        .nodes = calloc(8, sizeof(ChainNode *)),
+        .cap = 8
+    };
+}
+
+static void ChainMap_del(ChainMap *map) {
+    for (size_t i = 0; i < map->cap; ++i) {
+        ChainNode *trav = map->nodes[i];
+
+        while (trav) {
+            ChainNode *next = trav->next;
+
+            free(trav);
+            trav = next;
+        }
+    }
+
+    free(map->nodes);
+}
+
+static void ChainMap_put_lower(ChainMap *map, ChainNode *node) {
+    ChainNode **place = &map->nodes[node->name->hash % map->cap];
+
+    node->next = *place;
+    *place = node;
+}
+
+static void ChainMap_resize(ChainMap *map, size_t new_cap) {
+    ChainNode **old_nodes = map->nodes;
+    size_t old_cap = map->cap;
+
+    map->nodes = calloc(new_cap, sizeof(*map->nodes));
+    map->cap = new_cap;
+
+    for (size_t i = 0; i < old_cap; ++i) {
+        ChainNode *trav = old_nodes[i];
+
+        while (trav) {
+            ChainNode *next = trav->next;
+
+            ChainMap_put_lower(map, trav);
+            trav = next;
+        }
+    }
+
+    free(old_nodes);
+}
+
+static void ChainMap_put(ChainMap *map, const Word *name, unsigned id) {
+    if (map->size * 2 > map->cap)
+        ChainMap_resize(map, map->cap * 2);
+
+    ChainNode *node = malloc(sizeof(*node));
+
+    *node = (ChainNode){ .name = name, .id = id };
+
+    ChainMap_put_lower(map, node);
+
+    ++map->size;
+}
+
+static bool ChainMap_get_checked(const ChainMap *map, const Word *name,
+                                 unsigned *out_id) {
+    ChainNode *trav = map->nodes[name->hash % map->cap];
+
+    for (; trav; trav = trav->next) {
+        if (Word_eq(name, trav->name)) {
+            *out_id = trav->id;
+
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// benches =====================================================================
+
+typedef struct IdMapBench {
+    const Word *names, *missing;
+    size_t num_names;
+    // maps are rebuilt for every put run, and kept for the lookups
+    IdMap flat;
+    ChainMap chained;
+
+    unsigned sink;
+} IdMapBench;
+
+static void put_flat(void *ctx) {
+    IdMapBench *ib = ctx;
+
+    IdMap_del(&ib->flat);
+    ib->flat = IdMap_new();
+
+    for (size_t i = 0; i < ib->num_names; ++i)
+        IdMap_put(&ib->flat, &ib->names[i], i);
+}
+
+static void put_chained(void *ctx) {
+    IdMapBench *ib = ctx;
+
+    ChainMap_del(&ib->chained);
+    ib->chained = ChainMap_new();
+
+    for (size_t i = 0; i < ib->num_names; ++i)
+        ChainMap_put(&ib->chained, &ib->names[i], i);
+}
+
+static void get_flat(void *ctx) {
+    IdMapBench *ib = ctx;
+    unsigned id;
+
+    for (size_t i = 0; i < ib->num_names; ++i)
+        if (IdMap_get_checked(&ib->flat, &ib->names[i], &id))
+            ib->sink += id;
+}
+
+static void get_chained(void *ctx) {
+    IdMapBench *ib = ctx;
+    unsigned id;
+
+    for (size_t i = 0; i < ib->num_names; ++i)
+        if (ChainMap_get_checked(&ib->chained, &ib->names[i], &id))
+            ib->sink += id;
+}
+
+static void miss_flat(void *ctx) {
+    IdMapBench *ib = ctx;
+    unsigned id;
+
+    for (size_t i = 0; i < ib->num_names; ++i)
+        if (IdMap_get_checked(&ib->flat, &ib->missing[i], &id))
+            ib->sink += id;
+}
+
+static void miss_chained(void *ctx) {
+    IdMapBench *ib = ctx;
+    unsigned id;
+
+    for (size_t i = 0; i < ib->num_names; ++i)
+        if (ChainMap_get_checked(&ib->chained, &ib->missing[i], &id))
+            ib->sink += id;
+}
+
+// runs each small map bench enough times to be timed
+typedef struct Repeat {
+    void (*fn)(void *);
+    void *ctx;
+    size_t times;
+} Repeat;
+
+static void repeat(void *ctx) {
+    Repeat *r = ctx;
+
+    for (size_t i = 0; i < r->times; ++i)
+        r->fn(r->ctx);
+}
+
+static void run(const char *name, IdMapBench *ib) {
+    const struct { const char *op; void (*flat)(void *), (*chained)(void *); }
+    ops[] = {
+        { "put ", put_flat,  put_chained },
+        { "get ", get_flat,  get_chained },
+        { "miss", miss_flat, miss_chained },
+    };
+    size_t times = MAX(NUM_NAMES / ib->num_names, 1);
+
+    ib->flat = IdMap_new();
+    ib->chained = ChainMap_new();
+
+    printf("%s, %zu names:\n", name, ib->num_names);
+
+    for (size_t i = 0; i < ARRAY_SIZE(ops); ++i) {
+        Repeat flat = { ops[i].flat, ib, times };
+        Repeat chained = { ops[i].chained, ib, times };
+        double flat_ms = bench_best_ms(repeat, &flat, RUNS);
+        double chained_ms = bench_best_ms(repeat, &chained, RUNS);
+        double ops_done = (double)(ib->num_names * times);
+
+        printf("  %s flat %6.2f ns chained %6.2f ns (%.2fx)\n", ops[i].op,
+               flat_ms * 1e6 / ops_done, chained_ms * 1e6 / ops_done,
+               chained_ms / flat_ms);
+    }
+
+    IdMap_del(&ib->flat);
+    ChainMap_del(&ib->chained);
+}
+
+int main(void) {
+    words_init();
+
+    Word *names = malloc(NUM_NAMES * sizeof(*names));
+    Word *missing = malloc(NUM_NAMES * sizeof(*missing));
+    char buf[64];
+
+    for (size_t i = 0; i < NUM_NAMES; ++i) {
+        int len = snprintf(buf, sizeof(buf), "name_%zu", i);
+
+        names[i] = Word_new(buf, len);
+
+        len = snprintf(buf, sizeof(buf), "missing_%zu", i);
+        missing[i] = Word_new(buf, len);
+    }
+
+    // rule and prec tables are about this size
+    IdMapBench small = {
+        .names = names,
+        .missing = missing,
+        .num_names = SMALL_NAMES
+    };
+    IdMapBench large = {
+        .names = names,
+        .missing = missing,
+        .num_names = NUM_NAMES
+    };
+
+    puts("idmap:");
+    run("small", &small);
+    run("large", &large);
+
+    free(missing);
+    free(names);
+    words_quit();
+
+    return 0;
+}
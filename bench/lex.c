@@ -0,0 +1,80 @@
+#include "bench.h"
+
+/*
+ * lexer throughput in tokens/sec on identifier heavy code. the source is lexed
+ * as a whole on one thread, then split across as many threads as lex uses by
+ * default (one per cpu).
+ */
+
+#define NUM_LINES 400000
+#define RUNS 5
+
+typedef struct LexBench {
+    File file;
+    size_t num_toks;
+} LexBench;
+
+static void lex_whole(void *ctx) {
+    LexBench *lb = ctx;
+    Bump pool = Bump_new();
+    TokBuf toks = lex(&pool, &lb->file, &fungus_lang, 0, lb->file.text.len);
+
+    lb->num_toks = toks.len;
+    TokBuf_del(&toks);
+    Bump_del(&pool);
+}
+
+static void report(const char *name, const LexBench *lb, double ms) {
+    printf("  %-8s %8.2f ms %7.2f Mtok/s %7.1f MB/s\n", name, ms,
+           (double)lb->num_toks / (ms * 1e3),
+           (double)lb->file.text.len / (ms * 1e3));
+}
+
+int main(void) {
+    Names names;
+
+    bench_init(&names);
+
+    // short identifiers, operators and literals, about 5 bytes a token
+    const char *lines[] = {
+        "let count_%zu = index + offset * 2 - len / 4\n",
+        "x = (a_%zu + 3.25) %% b or !done and y >= 10\n",
+        "if n_%zu < max { n = n + 1 } else { n = 0 }\n",
+        "const name_%zu = \"value\" == label != true\n",
+    };
+    BenchText text = {0};
+
+    for (size_t i = 0; i < NUM_LINES; ++i)
+        bench_text_printf(&text, lines[i % ARRAY_SIZE(lines)], i);
+
+    LexBench lb = { .file = bench_file("lex", text.str, text.len) };
+
+    lex_max_threads = 1;
+    double serial_ms = bench_best_ms(lex_whole, &lb, RUNS);
+    size_t serial_toks = lb.num_toks;
+
+    lex_max_threads = 0;
+    double parallel_ms = bench_best_ms(lex_whole, &lb, RUNS);
+
+    if (global_error)
+        return 1;
+
+    printf("lex: %zu bytes, %zu tokens, %.2f bytes per token\n",
+           lb.file.text.len, lb.num_toks,
+           (double)lb.file.text.len / (double)lb.num_toks);
+
+    if (serial_toks != lb.num_toks) {
+        printf("  one thread lexed %zu tokens, all cpus %zu\n", serial_toks,
+               lb.num_toks);
+        return 1;
+    }
+
+    report("1 thread", &lb, serial_ms);
+    report("all cpus", &lb, parallel_ms);
+    printf("  speedup  %8.2fx\n", serial_ms / parallel_ms);
+
+    File_del(&lb.file);
+    bench_quit(&names);
+
+    return 0;
+}
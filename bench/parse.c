@@ -0,0 +1,104 @@
+#include "bench.h"
+#include "lex.h"
+#include "parse.h"
+
+/*
+ * parse time of both engines on pretokenized sources: many short top level
+ * exprs, and flat chains of one long expr, which is where sweeping used to go
+ * quadratic.
+ */
+
+#define NUM_LINES 10000
+#define NUM_TERMS 100000
+// climb recurses once per term of a right associative chain
+#define NUM_RIGHT_TERMS 10000
+#define RUNS 5
+
+typedef struct ParseBench {
+    File file;
+    TokBuf toks;
+    ParseEngine engine;
+} ParseBench;
+
+static void parse_toks(void *ctx) {
+    ParseBench *pb = ctx;
+    Bump pool = Bump_new();
+
+    fungus_lang.engine = pb->engine;
+
+    parse(&(AstCtx){
+        .pool = &pool,
+        .file = &pb->file,
+        .lang = &fungus_lang
+    }, &pb->toks);
+
+    Bump_del(&pool);
+}
+
+static void run(const char *name, BenchText *text) {
+    ParseBench pb = { .file = bench_file(name, text->str, text->len) };
+    Bump lex_pool = Bump_new();
+
+    pb.toks = lex(&lex_pool, &pb.file, &fungus_lang, 0, pb.file.text.len);
+
+    pb.engine = PARSE_SWEEP;
+    double sweep_ms = bench_best_ms(parse_toks, &pb, RUNS);
+    pb.engine = PARSE_CLIMB;
+    double climb_ms = bench_best_ms(parse_toks, &pb, RUNS);
+
+    printf("  %-12s %7zu tokens %9.2f ms sweep %9.2f ms climb\n", name,
+           pb.toks.len, sweep_ms, climb_ms);
+
+    TokBuf_del(&pb.toks);
+    Bump_del(&lex_pool);
+    File_del(&pb.file);
+    *text = (BenchText){0};
+}
+
+// `a<sep>a<sep>...a` with `terms` terms
+static void run_chain(const char *name, const char *sep, size_t terms) {
+    BenchText text = {0};
+
+    for (size_t i = 1; i < terms; ++i)
+        bench_text_printf(&text, "a%s", sep);
+
+    bench_text_printf(&text, "a\n");
+    run(name, &text);
+}
+
+int main(void) {
+    Names names;
+
+    bench_init(&names);
+
+    const char *lines[] = {
+        "let count_%zu = index + offset * 2 - len / 4\n",
+        "x = (a_%zu + 3.25) %% b or !done and y >= 10\n",
+        "if n_%zu < max { n = n + 1 } else { n = 0 }\n",
+        "const name_%zu = \"value\" == label != true\n",
+    };
+    BenchText text = {0};
+
+    printf("parse:\n");
+
+    for (size_t i = 0; i < NUM_LINES; ++i)
+        bench_text_printf(&text, lines[i % ARRAY_SIZE(lines)], i);
+
+    run("lines", &text);
+
+    for (size_t i = 0; i < 40; ++i)
+        bench_text_printf(&text, lines[i % ARRAY_SIZE(lines)], i);
+
+    run("short", &text);
+
+    run_chain("a + a", " + ", NUM_TERMS);
+    run_chain("a * a + a", " * a + ", NUM_TERMS);
+    run_chain("a = a", " = ", NUM_RIGHT_TERMS);
+
+    if (global_error)
+        return 1;
+
+    bench_quit(&names);
+
+    return 0;
+}
@@ -0,0 +1,92 @@
+#include "bench.h"
+#include "parse.h"
+#include "sema.h"
+
+/*
+ * word interning, on a large file of declarations which each look up earlier
+ * names. sema interns every identifier it sees and name_lookup compares it
+ * against each name in scope, so this is mostly Word_new and Word_eq.
+ */
+
+#define NUM_DECLS 4000
+#define RUNS 5
+
+typedef struct WordsBench {
+    File file;
+    Names *names;
+    TokBuf toks;
+    AstExpr *ast;
+    Bump pool;
+} WordsBench;
+
+static void intern_idents(void *ctx) {
+    WordsBench *wb = ctx;
+
+    for (size_t i = 0; i < wb->toks.len; ++i) {
+        if (wb->toks.types[i] == TOK_IDENT)
+            Word_new(&wb->file.text.str[wb->toks.starts[i]], wb->toks.lens[i]);
+    }
+}
+
+static void type_decls(void *ctx) {
+    WordsBench *wb = ctx;
+
+    sema(&(SemaCtx){
+        .pool = &wb->pool,
+        .file = &wb->file,
+        .lang = &fungus_lang,
+        .names = wb->names
+    }, wb->ast);
+}
+
+int main(void) {
+    Names names;
+
+    bench_init(&names);
+
+    BenchText text = {0};
+
+    bench_text_printf(&text, "let variable_0 = 1\n");
+
+    for (size_t i = 1; i < NUM_DECLS; ++i) {
+        bench_text_printf(&text, "let variable_%zu = variable_%zu + "
+                          "variable_%zu * 2\n", i, i - 1, i / 2);
+    }
+
+    WordsBench wb = {
+        .file = bench_file("words", text.str, text.len),
+        .names = &names,
+        .pool = Bump_new()
+    };
+
+    long base_kib = bench_peak_kib();
+
+    wb.toks = lex(&wb.pool, &wb.file, &fungus_lang, 0, wb.file.text.len);
+    wb.ast = parse(&(AstCtx){
+        .pool = &wb.pool,
+        .file = &wb.file,
+        .lang = &fungus_lang
+    }, &wb.toks);
+
+    if (global_error)
+        return 1;
+
+    double intern_ms = bench_best_ms(intern_idents, &wb, RUNS);
+    double sema_ms = bench_best_ms(type_decls, &wb, RUNS);
+
+    if (global_error)
+        return 1;
+
+    printf("words: %d decls, %zu tokens\n", NUM_DECLS, wb.toks.len);
+    printf("  intern identifiers %8.3f ms\n", intern_ms);
+    printf("  sema               %8.3f ms\n", sema_ms);
+    printf("  peak memory        %8ld KiB over startup\n",
+           bench_peak_kib() - base_kib);
+
+    TokBuf_del(&wb.toks);
+    Bump_del(&wb.pool);
+    File_del(&wb.file);
+    bench_quit(&names);
+
+    return 0;
+}
@@ -2,6 +2,75 @@ const std = @import("std");
 const mem = std.mem;
 const stdout = std.io.getStdOut().writer();
 
+// zig sources (compiled as separate objects and linked with C source)
+const zig_sources = [_][2][]const u8{
+    .{ "lex", "lex.zig" },
+    .{ "fir", "fir.zig" },
+};
+
+// every c source but main.c, so benches and tests can supply their own main
+const c_sources = [_][]const u8 {
+    "fungus.c",
+
+    "parse.c",
+    "compilation.c",
+    "lang.c",
+    "lang/rules.c",
+    "lang/precedence.c",
+    "lang/climb.c",
+    "lang/pattern.c",
+    "lang/ast_expr.c",
+
+    "sema.c",
+    "sema/types.c",
+    "sema/names.c",
+
+    "file.c",
+    "utils.c",
+    "data.c",
+};
+
+// bench/NAME.c, run by `zig build bench`
+const benches = [_][]const u8{
+    "hash",
+    "idmap",
+    "lex",
+    "parse",
+    "words",
+};
+
+// test/NAME.c, run by `zig build test`
+const tests = [_][]const u8{
+    "climb",
+    "edit",
+    "parse",
+};
+
+// zig sources with `test` blocks, also run by `zig build test`
+const zig_tests = [_][]const u8{
+    "lex.zig",
+};
+
+fn addFungusSources(
+    b: *std.build.Builder,
+    exe: *std.build.LibExeObjStep,
+    objs: []const *std.build.LibExeObjStep,
+    c_flags: []const []const u8,
+) void {
+    const src_dir = b.pathFromRoot("src");
+
+    exe.linkLibC();
+    exe.addIncludeDir("src");
+
+    for (objs) |obj| {
+        exe.addObject(obj);
+    }
+
+    for (c_sources) |source| {
+        exe.addCSourceFile(b.pathJoin(&.{src_dir, source}), c_flags);
+    }
+}
+
 pub fn build(b: *std.build.Builder) anyerror!void {
     var gpa = std.heap.GeneralPurposeAllocator(.{}){};
     const allocator = gpa.allocator();
@@ -10,95 +79,125 @@ pub fn build(b: *std.build.Builder) anyerror!void {
     const target = b.standardTargetOptions(.{});
     const mode = b.standardReleaseOptions();
 
+    const src_dir = b.pathFromRoot("src");
+
+    // zig objects
+    var objs: [zig_sources.len]*std.build.LibExeObjStep = undefined;
+
+    for (zig_sources) |name_and_path, i| {
+        const name = name_and_path[0];
+        const path = name_and_path[1];
+        const obj = b.addObject(name, b.pathJoin(&.{src_dir, path}));
+
+        // without this the zig objects are always built in debug mode
+        obj.setTarget(target);
+        obj.setBuildMode(mode);
+        obj.linkLibC();
+        obj.addIncludeDir("src");
+
+        objs[i] = obj;
+    }
+
+    // c flags
+    var c_flags = std.ArrayList([]const u8).init(allocator);
+    defer c_flags.deinit();
+
+    try c_flags.appendSlice(&.{
+        "-Wall",
+        "-Wextra",
+        "-Wpedantic",
+        "-Wvla",
+        "-std=c11"
+    });
+
+    if (mode == std.builtin.Mode.Debug) {
+        try c_flags.append("-DDEBUG");
+        try c_flags.append("-ggdb");
+        try c_flags.append("-O0");
+        // ubsan makes it impossible to debug segfaults w/ valgrind
+        try c_flags.append("-fno-sanitize=undefined");
+    } else {
+        try c_flags.append("-DNDEBUG");
+        try c_flags.append("-O3");
+    }
+
+    // fungus
     const exe = b.addExecutable("fungus", null);
 
     exe.setTarget(target);
     exe.setBuildMode(mode);
     exe.setOutputDir(".");
-    exe.linkLibC();
 
-    const src_dir = b.pathFromRoot("src");
-
-    // zig sources (compiled as separate objects and linked with C source)
-    {
-        const zig_sources = [_][2][]const u8{
-            .{ "lex", "lex.zig" },
-            .{ "fir", "fir.zig" },
-        };
+    addFungusSources(b, exe, &objs, c_flags.items);
+    exe.addCSourceFile(b.pathJoin(&.{src_dir, "main.c"}), c_flags.items);
 
-        for (zig_sources) |name_and_path| {
-            const name = name_and_path[0];
-            const path = name_and_path[1];
-            const obj = b.addObject(name, b.pathJoin(&.{src_dir, path}));
+    exe.install();
 
-            obj.linkLibC();
-            obj.addIncludeDir("src");
+    // zig build run
+    const run_cmd = exe.run();
+    run_cmd.step.dependOn(b.getInstallStep());
 
-            exe.addObject(obj);
-        }
+    if (b.args) |args| {
+        run_cmd.addArgs(args);
     }
 
-    // c sources
-    {
-        var c_flags = std.ArrayList([]const u8).init(allocator);
-        defer c_flags.deinit();
-
-        try c_flags.appendSlice(&.{
-            "-Wall",
-            "-Wextra",
-            "-Wpedantic",
-            "-Wvla",
-            "-std=c11"
-        });
-
-        if (mode == std.builtin.Mode.Debug) {
-            try c_flags.append("-DDEBUG");
-            try c_flags.append("-ggdb");
-            try c_flags.append("-O0");
-            // ubsan makes it impossible to debug segfaults w/ valgrind
-            try c_flags.append("-fno-sanitize=undefined");
-        } else {
-            try c_flags.append("-DNDEBUG");
-            try c_flags.append("-O3");
-        }
+    const run_step = b.step("run", "Run fungus!");
+    run_step.dependOn(&run_cmd.step);
 
-        const c_sources = [_][]const u8 {
-            "main.c",
-            "fungus.c",
+    // zig build bench + zig build test
+    const bench_step = b.step("bench", "Run benchmarks, use -Drelease-fast");
+    const test_step = b.step("test", "Run tests");
 
-            "parse.c",
-            "lang.c",
-            "lang/rules.c",
-            "lang/precedence.c",
-            "lang/pattern.c",
-            "lang/ast_expr.c",
+    inline for (benches) |name| {
+        const bench = b.addExecutable("bench_" ++ name, null);
 
-            "sema.c",
-            "sema/types.c",
-            "sema/names.c",
+        bench.setTarget(target);
+        bench.setBuildMode(mode);
 
-            "file.c",
-            "utils.c",
-            "data.c",
-        };
+        addFungusSources(b, bench, &objs, c_flags.items);
+        bench.addCSourceFile(b.pathFromRoot("bench/" ++ name ++ ".c"),
+                             c_flags.items);
 
-        for (c_sources) |source| {
-            const path = b.pathJoin(&.{src_dir, source});
+        const run_bench = bench.run();
 
-            exe.addCSourceFile(path, c_flags.items);
+        if (b.args) |args| {
+            run_bench.addArgs(args);
         }
+
+        bench_step.dependOn(&run_bench.step);
     }
 
-    exe.install();
+    inline for (tests) |name| {
+        const t = b.addExecutable("test_" ++ name, null);
 
-    // zig build run
-    const run_cmd = exe.run();
-    run_cmd.step.dependOn(b.getInstallStep());
+        t.setTarget(target);
+        t.setBuildMode(mode);
 
-    if (b.args) |args| {
-        run_cmd.addArgs(args);
+        addFungusSources(b, t, &objs, c_flags.items);
+        t.addCSourceFile(b.pathFromRoot("test/" ++ name ++ ".c"),
+                         c_flags.items);
+
+        test_step.dependOn(&t.run().step);
     }
 
-    const run_step = b.step("run", "Run fungus!");
-    run_step.dependOn(&run_cmd.step);
+    inline for (zig_tests) |path| {
+        const t = b.addTest(b.pathJoin(&.{src_dir, path}));
+
+        t.setTarget(target);
+        t.setBuildMode(mode);
+        t.linkLibC();
+        t.addIncludeDir("src");
+
+        // the file under test replaces its own object
+        for (zig_sources) |name_and_path, i| {
+            if (!mem.eql(u8, name_and_path[1], path))
+                t.addObject(objs[i]);
+        }
+
+        for (c_sources) |source| {
+            t.addCSourceFile(b.pathJoin(&.{src_dir, source}), c_flags.items);
+        }
+
+        test_step.dependOn(&t.step);
+    }
 }
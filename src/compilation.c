@@ -0,0 +1,664 @@
+#include <assert.h>
+
+#include "compilation.h"
+#include "fungus.h"
+#include "lang/ast_expr.h"
+
+// a full rebuild is forced once edits have reparsed this many times the file's
+// tokens, which bounds what they orphan in the pool
+#define REPARSE_GARBAGE_FACTOR 2
+
+// tokens ======================================================================
+
+/*
+ * the tokens are a gap buffer with the gap at the last edit, so an edit only
+ * moves the tokens between it and the edit before. starts in front of the gap
+ * are file offsets, starts behind it count back from `toks_end`, so moving
+ * `toks_end` shifts every token behind the gap at once.
+ */
+
+// index into the token arrays of the `i`th token
+static size_t tok_at(const Compilation *c, size_t i) {
+    return i < c->gap ? i : i + (c->cap - c->len);
+}
+
+static TokType tok_type(const Compilation *c, size_t i) {
+    return c->types[tok_at(c, i)];
+}
+
+static hsize_t tok_start(const Compilation *c, size_t i) {
+    hsize_t start = c->starts[tok_at(c, i)];
+
+    return i < c->gap ? start : c->toks_end - start;
+}
+
+static hsize_t tok_end(const Compilation *c, size_t i) {
+    return tok_start(c, i) + c->lens[tok_at(c, i)];
+}
+
+// moves the gap to before the `to`th token
+static void toks_move_gap(Compilation *c, size_t to) {
+    size_t width = c->cap - c->len;
+
+    // tokens crossing the gap switch between the two kinds of start
+    while (c->gap > to) {
+        size_t from = --c->gap;
+
+        c->types[from + width] = c->types[from];
+        c->starts[from + width] = c->toks_end - c->starts[from];
+        c->lens[from + width] = c->lens[from];
+        c->lits[from + width] = c->lits[from];
+    }
+
+    while (c->gap < to) {
+        size_t i = c->gap++;
+
+        c->types[i] = c->types[i + width];
+        c->starts[i] = c->toks_end - c->starts[i + width];
+        c->lens[i] = c->lens[i + width];
+        c->lits[i] = c->lits[i + width];
+    }
+}
+
+// grows the gap to fit at least `cap` tokens
+static void toks_reserve(Compilation *c, size_t cap) {
+    if (cap <= c->cap)
+        return;
+
+    size_t old_cap = c->cap;
+    size_t tail = c->len - c->gap;
+
+    c->cap = c->cap ? c->cap : 64;
+
+    while (c->cap < cap)
+        c->cap *= 2;
+
+    c->types = realloc(c->types, c->cap * sizeof(*c->types));
+    c->starts = realloc(c->starts, c->cap * sizeof(*c->starts));
+    c->lens = realloc(c->lens, c->cap * sizeof(*c->lens));
+    c->lits = realloc(c->lits, c->cap * sizeof(*c->lits));
+
+    // the tokens behind the gap stay at the end
+    size_t from = old_cap - tail, to = c->cap - tail;
+
+    memmove(&c->types[to], &c->types[from], tail * sizeof(*c->types));
+    memmove(&c->starts[to], &c->starts[from], tail * sizeof(*c->starts));
+    memmove(&c->lens[to], &c->lens[from], tail * sizeof(*c->lens));
+    memmove(&c->lits[to], &c->lits[from], tail * sizeof(*c->lits));
+}
+
+// replaces tokens [lo, hi) with `tb`, moving every token after them by `shift`
+static void toks_splice(Compilation *c, size_t lo, size_t hi, const TokBuf *tb,
+                        hsize_t shift) {
+    toks_move_gap(c, hi);
+
+    c->gap = lo;
+    c->len -= hi - lo;
+
+    toks_reserve(c, c->len + tb->len);
+
+    memcpy(&c->types[lo], tb->types, tb->len * sizeof(*c->types));
+    memcpy(&c->starts[lo], tb->starts, tb->len * sizeof(*c->starts));
+    memcpy(&c->lens[lo], tb->lens, tb->len * sizeof(*c->lens));
+    memcpy(&c->lits[lo], tb->lits, tb->len * sizeof(*c->lits));
+
+    c->gap += tb->len;
+    c->len += tb->len;
+    c->toks_end += shift;
+}
+
+// tokens [start, start + len) with file offset starts
+static TokBuf toks_view(Compilation *c, size_t start, size_t len) {
+    toks_move_gap(c, start + len);
+
+    return (TokBuf){
+        .types = &c->types[start],
+        .starts = &c->starts[start],
+        .lens = &c->lens[start],
+        .lits = &c->lits[start],
+        .len = len
+    };
+}
+
+// first token ending at or after `offset`
+static size_t toks_ending_at(const Compilation *c, size_t offset) {
+    size_t lo = 0, hi = c->len;
+
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+
+        if (tok_end(c, mid) < offset)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    return lo;
+}
+
+// first token starting after `offset`
+static size_t toks_starting_after(const Compilation *c, size_t offset) {
+    size_t lo = 0, hi = c->len;
+
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+
+        if (tok_start(c, mid) <= offset)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    return lo;
+}
+
+// a region can only be relexed on its own if every string and curly opened in
+// it is also closed in it
+static bool region_is_closed(const char *str, size_t len) {
+    size_t level = 0;
+
+    for (size_t i = 0; i < len; ++i) {
+        switch (str[i]) {
+        case '"':
+            for (++i; i < len && str[i] != '"'; ++i)
+                if (str[i] == '\\')
+                    ++i;
+
+            if (i >= len)
+                return false;
+
+            break;
+        case '{':
+            ++level;
+            break;
+        case '}':
+            if (!level)
+                return false;
+
+            --level;
+            break;
+        }
+    }
+
+    return level == 0;
+}
+
+// lexes [start, start + len) of the file, returns success. the token arrays
+// are copied out, but decoded strings stay in the pool
+static bool lex_region(Compilation *c, size_t start, size_t len,
+                       TokBuf *o_tb) {
+    *o_tb = lex(&c->pool, &c->file, c->lang, start, len);
+
+    return !global_error;
+}
+
+// ast =========================================================================
+
+static bool is_escaped_lexeme(const AstExpr *expr) {
+    return expr->type.id == ID_LITERAL && expr->evaltype.id == ID_LEXEME;
+}
+
+// every token becomes one atom, except escapes which are folded into the
+// lexeme they escape
+static size_t count_toks(const AstExpr *expr) {
+    if (AstExpr_is_atom(expr))
+        return is_escaped_lexeme(expr) ? 2 : 1;
+
+    size_t count = 0;
+
+    for (size_t i = 0; i < expr->len; ++i)
+        count += count_toks(expr->exprs[i]);
+
+    return count;
+}
+
+static void shift_atoms(AstExpr *expr, hsize_t shift) {
+    if (AstExpr_is_atom(expr)) {
+        expr->tok_start += shift;
+        return;
+    }
+
+    for (size_t i = 0; i < expr->len; ++i)
+        shift_atoms(expr->exprs[i], shift);
+}
+
+// whether `a` would have the same shape as `b` once moved by `shift`.
+// evaltypes are ignored, sema fills them in after parsing
+static bool ast_same(const AstExpr *a, const AstExpr *b, hsize_t shift) {
+    if (a->type.id != b->type.id)
+        return false;
+
+    if (AstExpr_is_atom(a)) {
+        return (hsize_t)(a->tok_start + shift) == b->tok_start
+            && a->tok_len == b->tok_len;
+    }
+
+    if (a->rule.id != b->rule.id || a->len != b->len)
+        return false;
+
+    for (size_t i = 0; i < a->len; ++i)
+        if (!ast_same(a->exprs[i], b->exprs[i], shift))
+            return false;
+
+    return true;
+}
+
+// an atom left at the top level is a rule that hasn't been completed yet, and
+// may still be completed by tokens on the other side of it
+static bool is_sealed(const AstExpr *expr) {
+    return !AstExpr_is_atom(expr);
+}
+
+/*
+ * the top level exprs are a gap buffer too, each with the index of its first
+ * token and the shift from edits before it that hasn't been applied to its
+ * atoms yet. behind the gap, these count back from `exprs_end` and
+ * `exprs_shift`, so an edit moves every expr after it at once.
+ */
+
+static size_t expr_at(const Compilation *c, size_t i) {
+    return i < c->exprs_gap ? i : i + (c->exprs_cap - c->exprs_len);
+}
+
+static AstExpr *expr_get(const Compilation *c, size_t i) {
+    return c->exprs[expr_at(c, i)];
+}
+
+// index of the first token of the `i`th expr, or of the end for `exprs_len`
+static size_t expr_start(const Compilation *c, size_t i) {
+    if (i == c->exprs_len)
+        return c->exprs_end;
+
+    size_t start = c->expr_starts[expr_at(c, i)];
+
+    return i < c->exprs_gap ? start : c->exprs_end - start;
+}
+
+static hsize_t expr_shift(const Compilation *c, size_t i) {
+    hsize_t shift = c->expr_shifts[expr_at(c, i)];
+
+    return i < c->exprs_gap ? shift : (hsize_t)(c->exprs_shift - shift);
+}
+
+// moves the gap to before the `to`th expr
+static void exprs_move_gap(Compilation *c, size_t to) {
+    size_t width = c->exprs_cap - c->exprs_len;
+
+    while (c->exprs_gap > to) {
+        size_t from = --c->exprs_gap;
+
+        c->exprs[from + width] = c->exprs[from];
+        c->expr_starts[from + width] = c->exprs_end - c->expr_starts[from];
+        c->expr_shifts[from + width] = c->exprs_shift - c->expr_shifts[from];
+    }
+
+    while (c->exprs_gap < to) {
+        size_t i = c->exprs_gap++;
+
+        c->exprs[i] = c->exprs[i + width];
+        c->expr_starts[i] = c->exprs_end - c->expr_starts[i + width];
+        c->expr_shifts[i] = c->exprs_shift - c->expr_shifts[i + width];
+    }
+}
+
+// grows the gap to fit at least `cap` exprs
+static void exprs_reserve(Compilation *c, size_t cap) {
+    if (cap <= c->exprs_cap)
+        return;
+
+    size_t old_cap = c->exprs_cap;
+    size_t tail = c->exprs_len - c->exprs_gap;
+
+    c->exprs_cap = c->exprs_cap ? c->exprs_cap : 64;
+
+    while (c->exprs_cap < cap)
+        c->exprs_cap *= 2;
+
+    c->exprs = realloc(c->exprs, c->exprs_cap * sizeof(*c->exprs));
+    c->expr_starts = realloc(c->expr_starts,
+                             c->exprs_cap * sizeof(*c->expr_starts));
+    c->expr_shifts = realloc(c->expr_shifts,
+                             c->exprs_cap * sizeof(*c->expr_shifts));
+
+    size_t from = old_cap - tail, to = c->exprs_cap - tail;
+
+    memmove(&c->exprs[to], &c->exprs[from], tail * sizeof(*c->exprs));
+    memmove(&c->expr_starts[to], &c->expr_starts[from],
+            tail * sizeof(*c->expr_starts));
+    memmove(&c->expr_shifts[to], &c->expr_shifts[from],
+            tail * sizeof(*c->expr_shifts));
+}
+
+// replaces exprs [first, last) with the exprs of `window`, which start at
+// token `start`. the exprs after them move by `tok_shift` tokens and `shift`
+// chars
+static void exprs_splice(Compilation *c, size_t first, size_t last,
+                         const AstExpr *window, size_t start,
+                         size_t tok_shift, hsize_t shift) {
+    exprs_move_gap(c, last);
+
+    c->exprs_gap = first;
+    c->exprs_len -= last - first;
+
+    exprs_reserve(c, c->exprs_len + window->len);
+
+    for (size_t i = 0; i < window->len; ++i) {
+        c->exprs[first + i] = window->exprs[i];
+        c->expr_starts[first + i] = start;
+        c->expr_shifts[first + i] = 0;
+
+        start += count_toks(window->exprs[i]);
+    }
+
+    c->exprs_gap += window->len;
+    c->exprs_len += window->len;
+    c->exprs_end += tok_shift;
+    c->exprs_shift += shift;
+}
+
+// number of exprs starting before token `tok`
+static size_t exprs_before(const Compilation *c, size_t tok) {
+    size_t lo = 0, hi = c->exprs_len;
+
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+
+        if (expr_start(c, mid) < tok)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    return lo;
+}
+
+static AstExpr *parse_toks(Compilation *c, size_t start, size_t len) {
+    TokBuf view = toks_view(c, start, len);
+
+    return parse(&(AstCtx){
+        .pool = &c->pool,
+        .file = &c->file,
+        .lang = c->lang
+    }, &view);
+}
+
+// rebuilding ==================================================================
+
+// also frees everything orphaned by edits
+static bool rebuild(Compilation *c) {
+    global_error = false;
+
+    Bump_del(&c->pool);
+    c->pool = Bump_new();
+    c->ast = NULL;
+    c->len = 0;
+    c->gap = 0;
+    c->toks_end = c->file.text.len;
+    c->reparsed = 0;
+
+    TokBuf tb;
+    bool lexed = lex_region(c, 0, c->file.text.len, &tb);
+
+    if (lexed)
+        toks_splice(c, 0, 0, &tb, 0);
+
+    TokBuf_del(&tb);
+
+    if (!lexed)
+        return false;
+
+    c->ast = parse_toks(c, 0, c->len);
+
+    if (global_error) {
+        c->ast = NULL;
+        return false;
+    }
+
+    c->exprs_len = 0;
+    c->exprs_gap = 0;
+    c->exprs_end = 0;
+    c->exprs_shift = 0;
+
+    exprs_splice(c, 0, 0, c->ast, 0, c->len, 0);
+
+    return true;
+}
+
+// edits =======================================================================
+
+// relexes the tokens around an edit already applied to the text. on success the
+// old tokens [lo, hi) have been replaced with `new_len` tokens
+static bool relex_edit(Compilation *c, size_t start, size_t old_len,
+                       size_t len, size_t *o_lo, size_t *o_hi,
+                       size_t *o_new_len) {
+    hsize_t shift = len - old_len;
+
+    /*
+     * damaged tokens touch the edit or are glued to a damaged token, either by
+     * having no space between them or by following an escape. the region
+     * between the undamaged neighbours is only whitespace at each end, so
+     * lexing it alone gives the same tokens a full relex would.
+     */
+    size_t lo = toks_ending_at(c, start);
+    size_t hi = toks_starting_after(c, start + old_len);
+
+    while (lo > 0 && (tok_type(c, lo - 1) == TOK_ESCAPE
+                   || (lo < c->len && tok_end(c, lo - 1) == tok_start(c, lo))))
+        --lo;
+
+    while (true) {
+        while (hi < c->len && hi > 0
+            && (tok_type(c, hi - 1) == TOK_ESCAPE
+             || tok_end(c, hi - 1) == tok_start(c, hi)))
+            ++hi;
+
+        size_t region_start = lo > 0 ? tok_end(c, lo - 1) : 0;
+        size_t region_end = hi < c->len ? (hsize_t)(tok_start(c, hi) + shift)
+                                        : c->file.text.len;
+        size_t region_len = region_end - region_start;
+
+        // curlies and strings can reach across the whole file
+        if (!region_is_closed(&c->file.text.str[region_start], region_len))
+            return false;
+
+        TokBuf tb;
+
+        if (!lex_region(c, region_start, region_len, &tb)) {
+            TokBuf_del(&tb);
+            return false;
+        }
+
+        // a new trailing escape changes how the next token lexes
+        if (hi < c->len && tb.len && tb.types[tb.len - 1] == TOK_ESCAPE) {
+            TokBuf_del(&tb);
+            ++hi;
+            continue;
+        }
+
+        toks_splice(c, lo, hi, &tb, shift);
+
+        *o_lo = lo;
+        *o_hi = hi;
+        *o_new_len = tb.len;
+
+        TokBuf_del(&tb);
+
+        return true;
+    }
+}
+
+#ifdef DEBUG
+// an edit must leave exactly what compiling the new text from scratch would
+static void check_against_rebuild(Compilation *c) {
+    Compilation full = Compilation_new(File_from_str(c->file.filepath,
+                                                     c->file.text.str,
+                                                     c->file.text.len),
+                                       c->lang);
+
+    TokBuf full_toks = Compilation_toks(&full);
+    TokBuf toks = Compilation_toks(c);
+
+    assert(full.ast && full_toks.len == toks.len);
+
+    for (size_t i = 0; i < toks.len; ++i) {
+        assert(full_toks.types[i] == toks.types[i]
+            && full_toks.starts[i] == toks.starts[i]
+            && full_toks.lens[i] == toks.lens[i]);
+    }
+
+    assert(ast_same(full.ast, Compilation_ast(c), 0));
+
+    Compilation_del(&full);
+}
+#endif
+
+// interface ===================================================================
+
+Compilation Compilation_new(File file, const Lang *lang) {
+    Compilation c = {
+        .file = file,
+        .lang = lang,
+        .pool = Bump_new()
+    };
+
+    rebuild(&c);
+
+    return c;
+}
+
+void Compilation_del(Compilation *c) {
+    free(c->expr_shifts);
+    free(c->expr_starts);
+    free(c->exprs);
+    free(c->lits);
+    free(c->lens);
+    free(c->starts);
+    free(c->types);
+    Bump_del(&c->pool);
+    File_del(&c->file);
+}
+
+bool Compilation_apply_edit(Compilation *c, size_t start, size_t old_len,
+                            const char *text, size_t len) {
+    hsize_t shift = len - old_len;
+
+    // success is read from global_error, a failure before this one can't count
+    global_error = false;
+
+    File_replace(&c->file, start, old_len, text, len);
+
+    if (!c->ast || !c->exprs_len)
+        return rebuild(c);
+
+    size_t lo, hi, new_len;
+
+    if (!relex_edit(c, start, old_len, len, &lo, &hi, &new_len)) {
+        if (global_error) {
+            c->ast = NULL;
+            return false;
+        }
+
+        return rebuild(c);
+    }
+
+    /*
+     * reparse the top level exprs holding damaged tokens along with one
+     * neighbour on each side. if a neighbour doesn't come out the same, the
+     * edit changed how it binds, so the window widens past it and tries again.
+     * a neighbour and the expr past it must also both be complete rules, or
+     * the reparse could be missing a match reaching across the boundary.
+     *
+     * until the exprs are spliced, their token indices are from before the
+     * edit.
+     */
+    size_t exprs_len = c->exprs_len;
+    size_t old_toks = c->exprs_end;
+    size_t first = lo < old_toks ? exprs_before(c, lo + 1) - 1 : exprs_len;
+    size_t last = exprs_before(c, hi);
+
+    if (last < first)
+        last = first;
+
+    if (first > 0)
+        --first;
+
+    if (last < exprs_len)
+        ++last;
+
+    size_t first_tok = expr_start(c, first);
+    size_t window_toks = expr_start(c, last) - first_tok - (hi - lo) + new_len;
+
+    if (c->reparsed + window_toks > REPARSE_GARBAGE_FACTOR * c->len)
+        return rebuild(c);
+
+    AstExpr *window;
+
+    while (true) {
+        window = parse_toks(c, first_tok, window_toks);
+
+        if (global_error) {
+            c->ast = NULL;
+            return false;
+        }
+
+        c->reparsed += window_toks;
+
+        bool left_same = first == 0
+            || (window->len && is_sealed(expr_get(c, first - 1))
+             && is_sealed(expr_get(c, first))
+             && ast_same(expr_get(c, first), window->exprs[0],
+                         expr_shift(c, first)));
+        bool right_same = last == exprs_len
+            || (window->len && is_sealed(expr_get(c, last))
+             && is_sealed(expr_get(c, last - 1))
+             && ast_same(expr_get(c, last - 1), window->exprs[window->len - 1],
+                         expr_shift(c, last - 1) + shift));
+
+        if (left_same && right_same)
+            break;
+
+        if (!left_same) {
+            --first;
+            first_tok = expr_start(c, first);
+            window_toks += expr_start(c, first + 1) - first_tok;
+        }
+
+        if (!right_same) {
+            window_toks += expr_start(c, last + 1) - expr_start(c, last);
+            ++last;
+        }
+    }
+
+    // the reused exprs after the window are shifted lazily
+    exprs_splice(c, first, last, window, first_tok, new_len - (hi - lo),
+                 shift);
+
+    c->ast = window;
+
+    DEBUG_SCOPE(1, check_against_rebuild(c););
+
+    return true;
+}
+
+AstExpr *Compilation_ast(Compilation *c) {
+    if (!c->ast)
+        return NULL;
+
+    exprs_move_gap(c, c->exprs_len);
+
+    for (size_t i = 0; i < c->exprs_len; ++i) {
+        if (c->expr_shifts[i]) {
+            shift_atoms(c->exprs[i], c->expr_shifts[i]);
+            c->expr_shifts[i] = 0;
+        }
+    }
+
+    c->ast->exprs = c->exprs;
+    c->ast->len = c->exprs_len;
+
+    return c->ast;
+}
+
+TokBuf Compilation_toks(Compilation *c) {
+    return toks_view(c, 0, c->len);
+}
@@ -0,0 +1,63 @@
+#ifndef COMPILATION_H
+#define COMPILATION_H
+
+#include "parse.h"
+
+/*
+ * Compilation keeps the tokens and AST of a file alive between edits, so an
+ * edit only relexes the tokens it touched and only reparses the top level
+ * exprs around them. everything else in the AST is reused as is.
+ */
+
+typedef struct Compilation {
+    File file;
+    const Lang *lang;
+
+    // owns every AstExpr and decoded string, including ones orphaned by edits
+    Bump pool;
+    // NULL after a failed edit; the next edit rebuilds it. its top level exprs
+    // are kept below, use Compilation_ast to read it
+    AstExpr *ast;
+
+    // tokens in file order, in a gap buffer starting at token `gap`. read them
+    // through Compilation_toks
+    TokType *types;
+    hsize_t *starts, *lens;
+    TokLit *lits;
+    size_t len, cap, gap;
+    hsize_t toks_end;
+
+    // top level exprs of `ast` in a gap buffer starting at expr `exprs_gap`,
+    // with the index of each one's first token and the shift from edits before
+    // it that hasn't been applied to its atoms yet
+    AstExpr **exprs;
+    size_t *expr_starts;
+    hsize_t *expr_shifts;
+    size_t exprs_len, exprs_cap, exprs_gap;
+    size_t exprs_end;
+    hsize_t exprs_shift;
+
+    // tokens reparsed since the last full build, used to bound pool garbage
+    size_t reparsed;
+} Compilation;
+
+// these clear global_error on entry, so each one reports only its own errors.
+// a failed build or edit leaves global_error set.
+
+// takes ownership of `file`
+Compilation Compilation_new(File file, const Lang *);
+void Compilation_del(Compilation *);
+
+// replaces `old_len` chars at `start` with `text` and brings the tokens and
+// AST up to date, returns success
+bool Compilation_apply_edit(Compilation *, size_t start, size_t old_len,
+                            const char *text, size_t len);
+// the AST with every atom at its current file offset, NULL if the last edit
+// failed. this closes the gap in the top level exprs, so it costs a pass over
+// the exprs after the last edit
+AstExpr *Compilation_ast(Compilation *);
+// every token with file offset starts. this closes the gap, so it costs a pass
+// over the tokens after the last edit
+TokBuf Compilation_toks(Compilation *);
+
+#endif
@@ -1,6 +1,10 @@
 #include <assert.h>
 #include <stdalign.h>
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 #include "data.h"
 
 #ifndef DATA_INIT_CAP
@@ -30,9 +34,10 @@ static void Vec_biggify(Vec *v) {
     }
 }
 
-// subtract one slot
+// subtract one slot, only shrinking once a quarter full so that push/pop
+// around a power of 2 doesn't realloc every time
 static void Vec_smolify(Vec *v) {
-    if (--v->len < v->cap / 2) {
+    if (--v->len < v->cap / 4 && v->cap > DATA_INIT_CAP) {
         v->cap /= 2;
         v->data = realloc(v->data, v->cap * sizeof(*v->data));
     }
@@ -45,10 +50,9 @@ void **Vec_alloc(Vec *v) {
     return &v->data[v->len - 1];
 }
 
+// keeps the buffer for reuse
 void Vec_clear(Vec *v) {
     v->len = 0;
-    v->cap = DATA_INIT_CAP;
-    v->data = realloc(v->data, v->cap * sizeof(*v->data));
 }
 
 void Vec_push(Vec *v, const void *item) {
@@ -88,26 +92,68 @@ void Vec_qsort(Vec *v, int (*cmp)(const void *, const void *)) {
 #define BUMP_PAGE_SIZE 4096
 #endif
 
+#ifndef BUMP_MAX_PAGE_SIZE
+#define BUMP_MAX_PAGE_SIZE (1024 * 1024)
+#endif
+
+// pages retained by Bump_clear
+#ifndef BUMP_KEEP_PAGES
+#define BUMP_KEEP_PAGES 4
+#endif
+
 #define ALIGNMENT (alignof(max_align_t))
 
-static void new_page(Bump *b) {
-    b->page = malloc(BUMP_PAGE_SIZE);
-    b->bump = 0;
+// regular size of a page at an index
+static size_t page_size_of(size_t page_idx) {
+    size_t size = BUMP_PAGE_SIZE;
+
+    while (page_idx-- && size < BUMP_MAX_PAGE_SIZE)
+        size *= 2;
+
+    return MIN(size, BUMP_MAX_PAGE_SIZE);
+}
+
+static BumpPage *BumpPage_new(Bump *b, size_t size) {
+    BumpPage *page = malloc(sizeof(*page) + size);
+
+    page->size = size;
+
+#ifdef DEBUG
+    b->allocated += size;
+#else
+    (void)b;
+#endif
+
+    return page;
+}
 
-    Vec_push(&b->pages, b->page);
+// moves to the next page, making sure it can fit at least nbytes
+static void next_page(Bump *b, size_t nbytes) {
+    size_t next_idx = b->page_idx + 1;
+    size_t size = MAX(page_size_of(next_idx), nbytes);
 
+    if (next_idx == b->pages.len) {
+        Vec_push(&b->pages, BumpPage_new(b, size));
+    } else if (((BumpPage *)b->pages.data[next_idx])->size < nbytes) {
+        // retained page is too small
 #ifdef DEBUG
-    b->allocated += BUMP_PAGE_SIZE;
+        b->allocated -= ((BumpPage *)b->pages.data[next_idx])->size;
 #endif
+
+        free(b->pages.data[next_idx]);
+        b->pages.data[next_idx] = BumpPage_new(b, size);
+    }
+
+    b->page = b->pages.data[next_idx];
+    b->page_idx = next_idx;
+    b->bump = 0;
 }
 
 Bump Bump_new(void) {
-    Bump b = {
-        .pages = Vec_new(),
-        .lost_n_found = Vec_new()
-    };
+    Bump b = { .pages = Vec_new() };
 
-    new_page(&b);
+    b.page = BumpPage_new(&b, page_size_of(0));
+    Vec_push(&b.pages, b.page);
 
     return b;
 }
@@ -122,63 +168,74 @@ void Bump_del(Bump *b) {
     for (size_t i = 0; i < b->pages.len; ++i)
         free(b->pages.data[i]);
 
-    for (size_t i = 0; i < b->lost_n_found.len; ++i)
-        free(b->lost_n_found.data[i]);
-
     Vec_del(&b->pages);
-    Vec_del(&b->lost_n_found);
 }
 
-void *Bump_alloc(Bump *b, size_t nbytes) {
-    // align nbytes
-    size_t align_n = nbytes % ALIGNMENT;
+void *Bump_alloc_aligned(Bump *b, size_t nbytes, size_t align) {
+    assert(align && !(align & (align - 1)) && align <= ALIGNMENT);
 
-    if (align_n)
-        nbytes += ALIGNMENT - align_n;
+    // align start of allocation
+    size_t start = (b->bump + align - 1) & ~(align - 1);
 
-    if (nbytes > BUMP_PAGE_SIZE) {
-        // custom large page
-        char *mem = malloc(nbytes);
+    // page would overflow if allocating this memory, need a new one
+    if (start + nbytes > b->page->size) {
+        next_page(b, nbytes);
+        start = 0;
+    }
 
-        Vec_push(&b->lost_n_found, mem);
+    // allocate from current page
+    void *ptr = &b->page->data[start];
 
 #ifdef DEBUG
-        b->allocated += nbytes;
+    b->total += start + nbytes - b->bump;
 #endif
 
-        return mem;
-    } else if (nbytes + b->bump > BUMP_PAGE_SIZE) {
-        // page would overflow if allocating this memory, need a new one
-        new_page(b);
-    }
+    b->bump = start + nbytes;
 
-    // allocate from current page
-    void *ptr = &b->page[b->bump];
+    return ptr;
+}
 
-    b->bump += nbytes;
+void *Bump_alloc(Bump *b, size_t nbytes) {
+    return Bump_alloc_aligned(b, nbytes, ALIGNMENT);
+}
 
+BumpMark Bump_mark(const Bump *b) {
+    return (BumpMark){
+        .page_idx = b->page_idx,
+        .bump = b->bump,
 #ifdef DEBUG
-    b->total += nbytes;
+        .total = b->total,
 #endif
-
-    return ptr;
+    };
 }
 
-void Bump_clear(Bump *b) {
-    // free all pages but the first
-    for (size_t i = 1; i < b->pages.len; ++i)
-        free(b->pages.data[i]);
+void Bump_reset_to(Bump *b, BumpMark mark) {
+    assert(mark.page_idx < b->pages.len);
+    assert(mark.page_idx < b->page_idx
+        || (mark.page_idx == b->page_idx && mark.bump <= b->bump));
 
-    for (size_t i = 0; i < b->lost_n_found.len; ++i)
-        free(b->lost_n_found.data[i]);
+    b->page = b->pages.data[mark.page_idx];
+    b->page_idx = mark.page_idx;
+    b->bump = mark.bump;
 
-    // reset bump
-    b->page = b->pages.data[0];
-    b->bump = 0;
+#ifdef DEBUG
+    b->total = mark.total;
+#endif
+}
+
+void Bump_clear(Bump *b) {
+    Bump_reset_to(b, (BumpMark){0});
 
+    // free all but the retained pages
+    for (size_t i = BUMP_KEEP_PAGES; i < b->pages.len; ++i) {
 #ifdef DEBUG
-    b->total = 0;
+        b->allocated -= ((BumpPage *)b->pages.data[i])->size;
 #endif
+
+        free(b->pages.data[i]);
+    }
+
+    b->pages.len = MIN(b->pages.len, BUMP_KEEP_PAGES);
 }
 
 // views + words ===============================================================
@@ -191,27 +248,119 @@ char View_get(const View *v, size_t index) {
     return index < v->len ? v->str[index] : '\0';
 }
 
+// word interning -------------------------------------------------------------
+
+static Bump intern_pool;
+static Word *interned; // indexed by sym - 1
+static size_t interned_len, interned_cap;
+static sym_t *intern_table; // open addressed; stores syms, 0 is empty
+static size_t intern_cap;
+// the interner isn't locked, so words are only made on the thread that
+// initialized it
+static _Thread_local bool intern_thread;
+
+void words_init(void) {
+    intern_pool = Bump_new();
+    intern_thread = true;
+
+    interned_cap = DATA_INIT_CAP;
+    interned = malloc(interned_cap * sizeof(*interned));
+
+    intern_cap = DATA_INIT_CAP;
+    intern_table = calloc(intern_cap, sizeof(*intern_table));
+}
+
+void words_quit(void) {
+    free(intern_table);
+    free(interned);
+    Bump_del(&intern_pool);
+}
+
+// returns slot that either contains this string or should contain it
+static sym_t *intern_find(const char *str, size_t len, hash_t hash) {
+    size_t mask = intern_cap - 1;
+    size_t idx = hash & mask;
+
+    while (intern_table[idx]) {
+        const Word *word = &interned[intern_table[idx] - 1];
+
+        if (word->hash == hash && word->len == len
+         && !memcmp(word->str, str, len))
+            break;
+
+        idx = (idx + 1) & mask;
+    }
+
+    return &intern_table[idx];
+}
+
+static void intern_resize(size_t new_cap) {
+    free(intern_table);
+
+    intern_cap = new_cap;
+    intern_table = calloc(intern_cap, sizeof(*intern_table));
+
+    for (size_t i = 0; i < interned_len; ++i) {
+        const Word *word = &interned[i];
+
+        *intern_find(word->str, word->len, word->hash) = word->sym;
+    }
+}
+
 Word Word_new(const char *str, size_t len) {
-    return (Word){
-        .str = str,
+    assert(intern_thread);
+
+    hash_t hash = word_hash(str, len);
+    sym_t *slot = intern_find(str, len, hash);
+
+    if (*slot)
+        return interned[*slot - 1];
+
+    // new string, intern it
+    if ((interned_len + 1) * 2 > intern_cap) {
+        intern_resize(intern_cap * 2);
+        slot = intern_find(str, len, hash);
+    }
+
+    if (interned_len == interned_cap) {
+        interned_cap *= 2;
+        interned = realloc(interned, interned_cap * sizeof(*interned));
+    }
+
+    char *copy = BUMP_ARRAY(&intern_pool, char, len + 1);
+
+    memcpy(copy, str, len);
+    copy[len] = '\0';
+
+    Word word = {
+        .str = copy,
         .len = len,
-        .hash = fnv_hash(str, len),
+        .hash = hash,
+        .sym = interned_len + 1
     };
+
+    interned[interned_len++] = word;
+    *slot = word.sym;
+
+    return word;
 }
 
+// -----------------------------------------------------------------------------
+
 Word *Word_copy_of(const Word *src, Bump *pool) {
-    char *str = Bump_alloc(pool, src->len * sizeof(*str));
-    Word *copy = Bump_alloc(pool, sizeof(*copy));
+    Word *copy = BUMP_NEW(pool, Word);
 
-    strncpy(str, src->str, src->len);
-    *copy = Word_new(str, src->len);
+    *copy = *src;
 
     return copy;
 }
 
 bool Word_eq(const Word *a, const Word *b) {
-    return a->len == b->len && a->hash == b->hash
-        && !strncmp(a->str, b->str, a->len);
+    // words that didn't come from Word_new have no sym
+    if (!a->sym || !b->sym)
+        return a->len == b->len && !memcmp(a->str, b->str, a->len);
+
+    return a->sym == b->sym;
 }
 
 bool Word_eq_view(const Word *a, const View *b) {
@@ -222,79 +371,75 @@ bool Word_eq_view(const Word *a, const View *b) {
 
 IdMap IdMap_new(void) {
     return (IdMap){
-        .nodes = calloc(DATA_INIT_CAP, sizeof(IdMapNode *)),
+        .slots = calloc(DATA_INIT_CAP, sizeof(IdMapSlot)),
         .cap = DATA_INIT_CAP
     };
 }
 
 void IdMap_del(IdMap *map) {
-    for (size_t i = 0; i < map->cap; ++i) {
-        IdMapNode *trav = map->nodes[i];
+    free(map->slots);
+}
 
-        while (trav) {
-            IdMapNode *next = trav->next;
+// syms are dense, so they need to be scattered
+static size_t IdMap_home(const IdMap *map, sym_t sym) {
+    return ((hash_t)sym * 0x9E3779B97F4A7C15ull >> 32) & (map->cap - 1);
+}
 
-            free(trav);
-            trav = next;
-        }
-    }
+// returns the slot containing name, or the empty slot that ends its probe
+static IdMapSlot *IdMap_find(const IdMap *map, const Word *name) {
+    assert(name->sym);
 
-    free(map->nodes);
-}
+    size_t mask = map->cap - 1;
+    size_t idx = IdMap_home(map, name->sym);
+
+    while (true) {
+        IdMapSlot *slot = &map->slots[idx];
 
-static void IdMap_put_lower(IdMap *map, IdMapNode *node) {
-    IdMapNode **place = &map->nodes[node->name->hash % map->cap];
+        if (!slot->name || slot->sym == name->sym)
+            return slot;
 
-    node->next = *place;
-    *place = node;
+        idx = (idx + 1) & mask;
+    }
 }
 
 static void IdMap_resize(IdMap *map, size_t new_cap) {
-    IdMapNode **old_nodes = map->nodes;
+    IdMapSlot *old_slots = map->slots;
     size_t old_cap = map->cap;
 
-    map->nodes = calloc(new_cap, sizeof(*map->nodes));
+    map->slots = calloc(new_cap, sizeof(*map->slots));
     map->cap = new_cap;
 
-    for (size_t i = 0; i < old_cap; ++i) {
-        IdMapNode *trav = old_nodes[i];
-
-        while (trav) {
-            IdMapNode *next = trav->next;
-
-            IdMap_put_lower(map, trav);
-            trav = next;
-        }
-    }
+    for (size_t i = 0; i < old_cap; ++i)
+        if (old_slots[i].name)
+            *IdMap_find(map, old_slots[i].name) = old_slots[i];
 
-    free(old_nodes);
+    free(old_slots);
 }
 
 void IdMap_put(IdMap *map, const Word *name, unsigned id) {
     // check for expansion
-    if (map->size * 2 > map->cap)
+    if ((map->size + 1) * 2 > map->cap)
         IdMap_resize(map, map->cap * 2);
 
-    // place node
-    // TODO fml the memory fragmentation :(
-    IdMapNode *node = malloc(sizeof(*node));
+    IdMapSlot *slot = IdMap_find(map, name);
 
-    *node = (IdMapNode){ .name = name, .id = id };
+    if (!slot->name)
+        ++map->size;
 
-    IdMap_put_lower(map, node);
-
-    ++map->size;
+    *slot = (IdMapSlot){
+        .name = name,
+        .sym = name->sym,
+        .id = id
+    };
 }
 
 bool IdMap_get_checked(const IdMap *map, const Word *name, unsigned *out_id) {
-    IdMapNode *trav = map->nodes[name->hash % map->cap];
+    const IdMapSlot *slot = IdMap_find(map, name);
 
-    for (; trav; trav = trav->next) {
-        if (Word_eq(name, trav->name)) {
-            *out_id = trav->id;
+    if (slot->name) {
+        *out_id = slot->id;
 
-            return true;
-        }
+        return true;
     }
 
     return false;
@@ -310,118 +455,171 @@ unsigned IdMap_get(const IdMap *map, const Word *name) {
                  (int)name->len, name->str);
 }
 
-void IdMap_remove(IdMap *map, const Word *name) {
-    // TODO if this function remains unused that would be REALLY nice for
-    // a replacement implementation
-    fungus_panic("IDMap_remove not impl'd");
+bool IdMap_remove(IdMap *map, const Word *name) {
+    IdMapSlot *slot = IdMap_find(map, name);
+
+    if (!slot->name)
+        return false;
+
+    // backward shift deletion; pull up any entries in the rest of the cluster
+    // that would no longer be reachable through the hole
+    size_t mask = map->cap - 1;
+    size_t hole = slot - map->slots;
+    size_t idx = (hole + 1) & mask;
+
+    while (map->slots[idx].name) {
+        size_t home = IdMap_home(map, map->slots[idx].sym);
+
+        // move entry if its home isn't cyclically within (hole, idx]
+        if (((idx - home) & mask) >= ((idx - hole) & mask)) {
+            map->slots[hole] = map->slots[idx];
+            hole = idx;
+        }
+
+        idx = (idx + 1) & mask;
+    }
+
+    map->slots[hole] = (IdMapSlot){0};
+    --map->size;
+
+    return true;
 }
 
 void IdMap_dump(IdMap *map) {
     puts("IdMap:");
 
     for (size_t i = 0; i < map->cap; ++i) {
-        if (map->nodes[i]) {
-            printf("%4zu | ", i);
+        const IdMapSlot *slot = &map->slots[i];
 
-            for (IdMapNode *trav = map->nodes[i]; trav; trav = trav->next) {
-                printf("'%.*s'", (int)trav->name->len, trav->name->str);
-                if (trav->next) printf(" -> ");
-            }
-
-            puts("");
+        if (slot->name) {
+            printf("%4zu | '%.*s' -> %u\n", i, (int)slot->name->len,
+                   slot->name->str, slot->id);
         }
     }
 }
 
-// put-only id set =============================================================
+// hash map + set ==============================================================
 
-IdSet IdSet_new(void) {
-    return (IdSet){
-        .supersets = Vec_new(),
-        .ids = malloc(DATA_INIT_CAP * sizeof(unsigned)),
-        .filled = calloc(DATA_INIT_CAP, sizeof(bool)),
-        .cap = DATA_INIT_CAP
-    };
-}
+#define GROUP_WIDTH HASHMAP_GROUP_WIDTH
+
+#define CTRL_EMPTY   ((uint8_t)0x80)
+#define CTRL_DELETED ((uint8_t)0xFE)
+
+// bit i is set for slot i of a group
+typedef uint32_t GroupMask;
+
+// the top bit of a control byte is only set for empty + deleted slots
+static GroupMask group_match_free(const uint8_t *group) {
+#ifdef __SSE2__
+    return _mm_movemask_epi8(_mm_loadu_si128((const __m128i *)group));
+#else
+    GroupMask mask = 0;
 
-void IdSet_del(IdSet *set) {
-    Vec_del(&set->supersets);
-    free(set->ids);
-    free(set->filled);
+    for (size_t i = 0; i < GROUP_WIDTH; ++i)
+        if (group[i] & 0x80)
+            mask |= (GroupMask)1 << i;
+
+    return mask;
+#endif
 }
 
-static void IdSet_put_lower(IdSet *set, unsigned id) {
-    size_t idx = fnv_hash((const char *)&id, sizeof(id)) % set->cap;
+static GroupMask group_match(const uint8_t *group, uint8_t ctrl) {
+#ifdef __SSE2__
+    __m128i bytes = _mm_loadu_si128((const __m128i *)group);
 
-    while (set->filled[idx])
-        idx = (idx + 1) % set->cap;
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(ctrl)));
+#else
+    GroupMask mask = 0;
 
-    set->ids[idx] = id;
-    set->filled[idx] = true;
+    for (size_t i = 0; i < GROUP_WIDTH; ++i)
+        if (group[i] == ctrl)
+            mask |= (GroupMask)1 << i;
+
+    return mask;
+#endif
 }
 
-static void IdSet_resize(IdSet *set, size_t new_cap) {
-    unsigned *old_ids = set->ids;
-    bool *old_filled = set->filled;
-    size_t old_cap = set->cap;
+// pops lowest set slot from a mask
+static size_t group_next(GroupMask *mask) {
+    size_t index = __builtin_ctz(*mask);
 
-    set->cap = new_cap;
-    set->ids = malloc(set->cap * sizeof(*set->ids));
-    set->filled = calloc(set->cap, sizeof(*set->filled));
+    *mask &= *mask - 1;
 
-    for (size_t i = 0; i < old_cap; ++i)
-        if (old_filled[i])
-            IdSet_put_lower(set, old_ids[i]);
+    return index;
 }
 
-void IdSet_add_superset(IdSet *set, IdSet *super) {
-    assert(set != super);
+static size_t hash_group(const HashMap *map, hash_t hash) {
+    return (hash >> 7) & (map->cap / GROUP_WIDTH - 1);
+}
 
-    Vec_push(&set->supersets, super);
+static uint8_t hash_ctrl(hash_t hash) {
+    return hash & 0x7F;
+}
 
-    for (size_t i = 0; i < set->cap; ++i)
-        if (set->filled[i])
-            IdSet_put(super, set->ids[i]);
+// probing visits groups by triangular numbers, which covers every group when
+// the number of groups is a power of 2
+static size_t probe_next(const HashMap *map, size_t group, size_t *step) {
+    return (group + ++*step) & (map->cap / GROUP_WIDTH - 1);
 }
 
-void IdSet_put(IdSet *set, unsigned id) {
-    // check resize
-    if (set->size * 2 > set->cap)
-        IdSet_resize(set, set->cap * 2);
+// keys are interned, so they carry their hash and compare by sym
+static bool HashMap_find(const HashMap *map, const Word *key, size_t *o_index) {
+    hash_t hash = key->hash;
+    uint8_t ctrl = hash_ctrl(hash);
+    size_t group = hash_group(map, hash), step = 0;
 
-    // add to this set
-    IdSet_put_lower(set, id);
+    while (true) {
+        const uint8_t *ctrls = &map->ctrl[group * GROUP_WIDTH];
+        GroupMask matches = group_match(ctrls, ctrl);
 
-    ++set->size;
+        while (matches) {
+            size_t index = group * GROUP_WIDTH + group_next(&matches);
 
-    // add to supersets
-    for (size_t i = 0; i < set->supersets.len; ++i)
-        IdSet_put(set->supersets.data[i], id);
-}
+            if (Word_eq(&map->keys[index], key)) {
+                *o_index = index;
 
-bool IdSet_has(const IdSet *set, unsigned id) {
-    size_t idx = fnv_hash((const char *)&id, sizeof(id)) % set->cap;
+                return true;
+            }
+        }
 
-    while (set->filled[idx]) {
-        if (set->ids[idx] == id)
-            return true;
+        // an empty slot means the key would have been placed in this group
+        if (group_match(ctrls, CTRL_EMPTY))
+            return false;
 
-        idx = (idx + 1) % set->cap;
+        group = probe_next(map, group, &step);
     }
+}
 
-    return false;
+// finds the first empty or deleted slot in a hash's probe sequence
+static size_t HashMap_find_free(const HashMap *map, hash_t hash) {
+    size_t group = hash_group(map, hash), step = 0;
+
+    while (true) {
+        GroupMask free = group_match_free(&map->ctrl[group * GROUP_WIDTH]);
+
+        if (free)
+            return group * GROUP_WIDTH + group_next(&free);
+
+        group = probe_next(map, group, &step);
+    }
 }
 
-// put-only pash map + set =====================================================
+static void HashMap_alloc(HashMap *map, size_t cap) {
+    map->cap = cap;
+    map->size = map->tombstones = 0;
+    map->ctrl = malloc(cap * sizeof(*map->ctrl));
+    map->keys = calloc(cap, sizeof(*map->keys));
+    map->values = map->is_set ? NULL : malloc(cap * sizeof(*map->values));
+
+    memset(map->ctrl, CTRL_EMPTY, cap * sizeof(*map->ctrl));
+}
 
 static HashMap HashMap_new_lower(bool is_set) {
-    return (HashMap){
-        .keys = calloc(DATA_INIT_CAP, sizeof(Word)),
-        .values = is_set ? NULL : malloc(DATA_INIT_CAP * sizeof(void *)),
-        .cap = DATA_INIT_CAP,
+    HashMap map = { .is_set = is_set };
 
-        .is_set = is_set
-    };
+    HashMap_alloc(&map, GROUP_WIDTH);
+
+    return map;
 }
 
 HashMap HashMap_new(void) {
@@ -429,112 +627,108 @@ HashMap HashMap_new(void) {
 }
 
 void HashMap_del(HashMap *map) {
+    free(map->ctrl);
     free(map->keys);
     free(map->values);
 }
 
 static void HashMap_put_lower(HashMap *map, const Word *key, void *value) {
-    size_t index = key->hash % map->cap;
+    size_t index = HashMap_find_free(map, key->hash);
 
-    while (map->keys[index].str)
-        index = (index + 1) % map->cap;
+    if (map->ctrl[index] == CTRL_DELETED)
+        --map->tombstones;
 
+    map->ctrl[index] = hash_ctrl(key->hash);
     map->keys[index] = *key;
 
     if (!map->is_set)
         map->values[index] = value;
+
+    ++map->size;
 }
 
+// rehashes into a new table, which also clears tombstones
 static void HashMap_resize(HashMap *map, size_t new_cap) {
-    size_t old_cap = map->cap;
-    Word *old_keys = map->keys;
-    void **old_values = map->values;
+    HashMap old = *map;
 
-    map->cap = new_cap;
-    map->keys = calloc(map->cap, sizeof(*map->keys));
-
-    if (!map->is_set)
-        map->values = calloc(map->cap, sizeof(*map->values));
+    HashMap_alloc(map, new_cap);
 
-    for (size_t i = 0; i < old_cap; ++i) {
-        if (old_keys[i].str) {
-            HashMap_put_lower(map, &old_keys[i],
-                              map->is_set ? NULL : old_values[i]);
+    for (size_t i = 0; i < old.cap; ++i) {
+        if (old.keys[i].str) {
+            HashMap_put_lower(map, &old.keys[i],
+                              map->is_set ? NULL : old.values[i]);
         }
     }
 
-    free(old_keys);
-    free(old_values);
+    HashMap_del(&old);
 }
 
 void HashMap_put(HashMap *map, const Word *key, void *value) {
-    if (map->size * 2 > map->cap)
-        HashMap_resize(map, map->cap * 2);
+    size_t index;
 
-    HashMap_put_lower(map, key, value);
-
-    ++map->size;
-}
+    if (HashMap_find(map, key, &index)) {
+        if (!map->is_set)
+            map->values[index] = value;
 
-bool HashMap_get_checked(const HashMap *map, const Word *key, void **o_value) {
-    size_t index = key->hash % map->cap;
+        return;
+    }
 
-    while (map->keys[index].str) {
-        if (Word_eq(&map->keys[index], key)) {
-            if (!map->is_set)
-                *o_value = map->values[index];
+    // keep load (including tombstones) under 7/8
+    if ((map->size + map->tombstones + 1) * 8 > map->cap * 7) {
+        size_t new_cap = map->cap;
 
-            return true;
-        }
+        if ((map->size + 1) * 2 > map->cap)
+            new_cap *= 2;
 
-        index = (index + 1) % map->cap;
+        HashMap_resize(map, new_cap);
     }
 
-    return false;
+    HashMap_put_lower(map, key, value);
 }
 
-void *HashMap_get(const HashMap *map, const Word *key) {
-    void *value;
+bool HashMap_remove(HashMap *map, const Word *key) {
+    size_t index;
 
-    if (HashMap_get_checked(map, key, &value))
-        return value;
+    if (!HashMap_find(map, key, &index))
+        return false;
 
-    fungus_panic("HashMap failed to retrieve '%.*s'!\n",
-                 (int)key->len, key->str);
-}
+    // if this group has an empty slot, no probe has ever continued past it and
+    // this slot can be emptied instead of leaving a tombstone
+    const uint8_t *group = &map->ctrl[index - index % GROUP_WIDTH];
 
-size_t HashMap_get_longest(const HashMap *map, const View *key, void **o_val) {
-    hash_t hash = fnv_hash_start();
-    size_t matched = 0;
-    void *best = NULL;
+    if (group_match(group, CTRL_EMPTY)) {
+        map->ctrl[index] = CTRL_EMPTY;
+    } else {
+        map->ctrl[index] = CTRL_DELETED;
+        ++map->tombstones;
+    }
 
-    for (size_t i = 0; i < key->len; ++i) {
-        hash = fnv_hash_next(hash, key->str[i]);
+    map->keys[index] = (Word){0};
+    --map->size;
 
-        Word slice = {
-            .str = key->str,
-            .len = i + 1,
-            .hash = hash
-        };
+    return true;
+}
 
-#ifdef DEBUG
-        Word test = Word_new(slice.str, slice.len);
+bool HashMap_get_checked(const HashMap *map, const Word *key, void **o_value) {
+    size_t index;
 
-        assert(Word_eq(&slice, &test));
-#endif
+    if (!HashMap_find(map, key, &index))
+        return false;
 
-        void *value = NULL;
+    if (!map->is_set)
+        *o_value = map->values[index];
 
-        if (HashMap_get_checked(map, &slice, &value)) {
-            best = value;
-            matched = slice.len;
-        }
-    }
+    return true;
+}
 
-    if (o_val)
-        *o_val = best;
+void *HashMap_get(const HashMap *map, const Word *key) {
+    void *value = NULL;
 
-    return matched;
+    if (HashMap_get_checked(map, key, &value))
+        return value;
+
+    fungus_panic("HashMap failed to retrieve '%.*s'!\n",
+                 (int)key->len, key->str);
 }
 
 HashSet HashSet_new(void) {
@@ -549,12 +743,12 @@ void HashSet_put(HashSet *set, const Word *word) {
     HashMap_put(&set->map, word, NULL);
 }
 
-bool HashSet_has(const HashSet *set, const Word *word) {
-    return HashMap_get_checked(&set->map, word, NULL);
+bool HashSet_remove(HashSet *set, const Word *word) {
+    return HashMap_remove(&set->map, word);
 }
 
-size_t HashSet_longest(const HashSet *set, const View *word) {
-    return HashMap_get_longest(&set->map, word, NULL);
+bool HashSet_has(const HashSet *set, const Word *word) {
+    return HashMap_get_checked(&set->map, word, NULL);
 }
 
 void HashSet_print(const HashSet *set) {
@@ -573,3 +767,246 @@ void HashSet_print(const HashSet *set) {
         }
     }
 }
+
+// immutable perfect hash map =================================================
+
+#define PERFECT_MAX_DISP 0x100000
+
+// second level hash, mixes a Word hash with a bucket displacement
+static size_t PerfectMap_slot(hash_t hash, uint32_t disp, size_t size) {
+    hash_t x = hash + (hash_t)disp * 0x9E3779B97F4A7C15ull;
+
+    x ^= x >> 31;
+    x *= 0xBF58476D1CE4E5B9ull;
+    x ^= x >> 29;
+
+    return x % size;
+}
+
+typedef struct PerfectBucket {
+    size_t *keys; // indices into keys passed to PerfectMap_new
+    size_t len;
+    size_t index;
+} PerfectBucket;
+
+static int PerfectBucket_cmp(const void *a, const void *b) {
+    const PerfectBucket *x = a, *y = b;
+
+    // largest buckets are placed first
+    if (x->len != y->len)
+        return x->len < y->len ? 1 : -1;
+
+    return x->index < y->index ? -1 : x->index > y->index;
+}
+
+PerfectMap PerfectMap_new(const Word *keys, const unsigned *values, size_t n) {
+    PerfectMap map = { .num_buckets = n / 2 + 1 };
+
+    // split keys into buckets, skipping duplicates
+    PerfectBucket *buckets = calloc(map.num_buckets, sizeof(*buckets));
+    size_t *bucket_keys = malloc(n * sizeof(*bucket_keys));
+    size_t *bucket_of = malloc(n * sizeof(*bucket_of));
+    size_t *bucket_starts = calloc(map.num_buckets + 1, sizeof(*bucket_starts));
+
+    for (size_t i = 0; i < n; ++i) {
+        bucket_of[i] = keys[i].hash % map.num_buckets;
+        ++bucket_starts[bucket_of[i] + 1];
+    }
+
+    for (size_t i = 0; i < map.num_buckets; ++i) {
+        bucket_starts[i + 1] += bucket_starts[i];
+        buckets[i].keys = &bucket_keys[bucket_starts[i]];
+        buckets[i].index = i;
+    }
+
+    for (size_t i = 0; i < n; ++i) {
+        PerfectBucket *bucket = &buckets[bucket_of[i]];
+        bool duplicate = false;
+
+        for (size_t j = 0; j < bucket->len; ++j) {
+            if (Word_eq(&keys[bucket->keys[j]], &keys[i])) {
+                duplicate = true;
+                break;
+            }
+        }
+
+        if (!duplicate) {
+            bucket->keys[bucket->len++] = i;
+            ++map.size;
+        }
+    }
+
+    free(bucket_of);
+    free(bucket_starts);
+
+    // find a displacement for each bucket which places all of its keys in
+    // free slots
+    map.keys = calloc(MAX(map.size, 1), sizeof(*map.keys));
+    map.values = malloc(MAX(map.size, 1) * sizeof(*map.values));
+    map.disps = calloc(map.num_buckets, sizeof(*map.disps));
+
+    bool *taken = calloc(MAX(map.size, 1), sizeof(*taken));
+    size_t *slots = malloc(MAX(map.size, 1) * sizeof(*slots));
+
+    qsort(buckets, map.num_buckets, sizeof(*buckets), PerfectBucket_cmp);
+
+    for (size_t i = 0; i < map.num_buckets && buckets[i].len; ++i) {
+        const PerfectBucket *bucket = &buckets[i];
+        uint32_t disp;
+
+        for (disp = 0; disp < PERFECT_MAX_DISP; ++disp) {
+            size_t placed = 0;
+
+            for (; placed < bucket->len; ++placed) {
+                hash_t hash = keys[bucket->keys[placed]].hash;
+                size_t slot = PerfectMap_slot(hash, disp, map.size);
+
+                if (taken[slot])
+                    break;
+
+                taken[slot] = true;
+                slots[placed] = slot;
+            }
+
+            if (placed == bucket->len)
+                break;
+
+            // collided, undo this attempt
+            for (size_t j = 0; j < placed; ++j)
+                taken[slots[j]] = false;
+        }
+
+        if (disp == PERFECT_MAX_DISP)
+            fungus_panic("PerfectMap failed to find a displacement.");
+
+        map.disps[bucket->index] = disp;
+
+        for (size_t j = 0; j < bucket->len; ++j) {
+            map.keys[slots[j]] = keys[bucket->keys[j]];
+            map.values[slots[j]] = values[bucket->keys[j]];
+        }
+    }
+
+    free(slots);
+    free(taken);
+    free(bucket_keys);
+    free(buckets);
+
+    return map;
+}
+
+void PerfectMap_del(PerfectMap *map) {
+    free(map->keys);
+    free(map->values);
+    free(map->disps);
+}
+
+bool PerfectMap_get_checked(const PerfectMap *map, const View *key,
+                            unsigned *o_value) {
+    if (!map->size)
+        return false;
+
+    hash_t hash = word_hash(key->str, key->len);
+    uint32_t disp = map->disps[hash % map->num_buckets];
+    size_t slot = PerfectMap_slot(hash, disp, map->size);
+
+    if (!Word_eq_view(&map->keys[slot], key))
+        return false;
+
+    *o_value = map->values[slot];
+
+    return true;
+}
+
+// put-only longest match trie =================================================
+
+static size_t Trie_new_node(Trie *trie) {
+    if (trie->len > UINT16_MAX)
+        fungus_panic("Trie exceeded maximum node count.");
+
+    if (trie->len == trie->cap) {
+        size_t old_cap = trie->cap;
+
+        trie->cap *= 2;
+        trie->next = realloc(trie->next,
+                             trie->cap * TRIE_WIDTH * sizeof(*trie->next));
+        trie->values = realloc(trie->values,
+                               trie->cap * sizeof(*trie->values));
+
+        memset(&trie->next[old_cap * TRIE_WIDTH], 0,
+               (trie->cap - old_cap) * TRIE_WIDTH * sizeof(*trie->next));
+        memset(&trie->values[old_cap], 0,
+               (trie->cap - old_cap) * sizeof(*trie->values));
+    }
+
+    return trie->len++;
+}
+
+Trie Trie_new(void) {
+    Trie trie = {
+        .next = calloc(DATA_INIT_CAP * TRIE_WIDTH, sizeof(*trie.next)),
+        .values = calloc(DATA_INIT_CAP, sizeof(*trie.values)),
+        .cap = DATA_INIT_CAP
+    };
+
+    // root
+    Trie_new_node(&trie);
+
+    return trie;
+}
+
+void Trie_del(Trie *trie) {
+    free(trie->next);
+    free(trie->values);
+}
+
+static bool Trie_indexable(char ch) {
+    return (unsigned char)ch >= TRIE_FIRST_CHAR;
+}
+
+void Trie_put(Trie *trie, const Word *word, unsigned value) {
+    assert(value);
+
+    size_t node = 0;
+
+    for (size_t i = 0; i < word->len; ++i) {
+        if (!Trie_indexable(word->str[i])) {
+            fungus_panic("can't place '%.*s' in a Trie.",
+                         (int)word->len, word->str);
+        }
+
+        size_t edge =
+            node * TRIE_WIDTH + (unsigned char)word->str[i] - TRIE_FIRST_CHAR;
+
+        if (!trie->next[edge]) {
+            // trie->next may move during node creation
+            size_t child = Trie_new_node(trie);
+
+            trie->next[edge] = child;
+        }
+
+        node = trie->next[edge];
+    }
+
+    trie->values[node] = value;
+}
+
+size_t Trie_longest(const Trie *trie, const View *word, unsigned *o_value) {
+    size_t node = 0;
+    size_t matched = 0;
+
+    for (size_t i = 0; i < word->len && Trie_indexable(word->str[i]); ++i) {
+        unsigned char ch = word->str[i];
+
+        node = trie->next[node * TRIE_WIDTH + ch - TRIE_FIRST_CHAR];
+
+        if (!node)
+            break;
+        else if (trie->values[node]) {
+            matched = i + 1;
+            *o_value = trie->values[node];
+        }
+    }
+
+    return matched;
+}
@@ -3,6 +3,8 @@
 
 #include <stddef.h>
 #include <stdbool.h>
+#include <stdalign.h>
+#include <stdint.h>
 #include <string.h>
 
 #include "utils.h"
@@ -24,27 +26,149 @@ void *Vec_pop(Vec *);
 void Vec_ordered_insert(Vec *, size_t idx, const void *item);
 void Vec_qsort(Vec *, int (*cmp)(const void *, const void *));
 
+/*
+ * typed dyn array with inline storage for N items, only going to the heap once
+ * it outgrows them. SMALLVEC(NAME, TYPE, N) generates the struct NAME and
+ * NAME_new/del/data/reserve/push/pop/clear. access items through NAME_data(),
+ * the buffer moves between inline and heap storage as the capacity changes.
+ *
+ * pops only shrink the heap buffer once it is a quarter full, so alternating
+ * pushes and pops around a boundary don't thrash the allocator.
+ */
+#define SMALLVEC(NAME, TYPE, N)\
+    typedef struct NAME {\
+        size_t len, cap;\
+        union {\
+            TYPE *heap;\
+            TYPE small[N];\
+        };\
+    } NAME;\
+    \
+    static inline NAME NAME##_new(void) {\
+        return (NAME){ .cap = (N) };\
+    }\
+    \
+    static inline bool NAME##_is_small(const NAME *v) {\
+        return v->cap <= (N);\
+    }\
+    \
+    static inline void NAME##_del(NAME *v) {\
+        if (!NAME##_is_small(v))\
+            free(v->heap);\
+    }\
+    \
+    static inline TYPE *NAME##_data(const NAME *v) {\
+        return NAME##_is_small(v) ? (TYPE *)v->small : v->heap;\
+    }\
+    \
+    /* moves items between inline and heap storage as needed */\
+    static inline void NAME##_set_cap(NAME *v, size_t cap) {\
+        if (cap <= (N)) {\
+            if (!NAME##_is_small(v)) {\
+                TYPE *heap = v->heap;\
+                memcpy(v->small, heap, v->len * sizeof(TYPE));\
+                free(heap);\
+            }\
+            \
+            v->cap = (N);\
+        } else if (NAME##_is_small(v)) {\
+            TYPE *heap = malloc(cap * sizeof(TYPE));\
+            memcpy(heap, v->small, v->len * sizeof(TYPE));\
+            \
+            v->heap = heap;\
+            v->cap = cap;\
+        } else {\
+            v->heap = realloc(v->heap, cap * sizeof(TYPE));\
+            v->cap = cap;\
+        }\
+    }\
+    \
+    static inline void NAME##_reserve(NAME *v, size_t cap) {\
+        if (cap > v->cap)\
+            NAME##_set_cap(v, cap);\
+    }\
+    \
+    static inline void NAME##_push(NAME *v, TYPE item) {\
+        if (v->len == v->cap)\
+            NAME##_set_cap(v, v->cap * 2);\
+        \
+        NAME##_data(v)[v->len++] = item;\
+    }\
+    \
+    static inline TYPE NAME##_pop(NAME *v) {\
+        TYPE item = NAME##_data(v)[--v->len];\
+        \
+        if (!NAME##_is_small(v) && v->len <= v->cap / 4)\
+            NAME##_set_cap(v, v->cap / 2);\
+        \
+        return item;\
+    }\
+    \
+    /* keeps the buffer for reuse */\
+    static inline void NAME##_clear(NAME *v) {\
+        v->len = 0;\
+    }
+
 // bump memory =================================================================
 
+/*
+ * pages grow geometrically up to a max size; allocations that don't fit in a
+ * regular page just get a page large enough for them. marks allow rolling
+ * back allocations, any pages past the mark are kept for reuse.
+ */
+
+typedef struct BumpPage {
+    union {
+        size_t size;
+        max_align_t align_;
+    };
+    char data[];
+} BumpPage;
+
 typedef struct Bump {
-    Vec pages, lost_n_found;
-    char *page;
-    size_t bump;
+    Vec pages; // Vec<BumpPage *>
+    BumpPage *page; // current page, pages after this are retained for reuse
+    size_t page_idx, bump;
 
 #ifdef DEBUG
     size_t total, allocated;
 #endif
 } Bump;
 
+typedef struct BumpMark {
+    size_t page_idx, bump;
+
+#ifdef DEBUG
+    size_t total;
+#endif
+} BumpMark;
+
 Bump Bump_new(void);
 void Bump_del(Bump *);
 
+// Bump_alloc aligns to max_align_t; use the typed macros for anything with a
+// smaller natural alignment so allocations can be packed
 void *Bump_alloc(Bump *, size_t nbytes);
+void *Bump_alloc_aligned(Bump *, size_t nbytes, size_t align);
+
+#define BUMP_NEW(BUMP, TYPE)\
+    ((TYPE *)Bump_alloc_aligned(BUMP, sizeof(TYPE), alignof(TYPE)))
+#define BUMP_ARRAY(BUMP, TYPE, N)\
+    ((TYPE *)Bump_alloc_aligned(BUMP, (N) * sizeof(TYPE), alignof(TYPE)))
 
+// rolls back every allocation made since a mark was taken
+BumpMark Bump_mark(const Bump *);
+void Bump_reset_to(Bump *, BumpMark);
+
+// resets all allocations, retaining the first few pages
 void Bump_clear(Bump *);
 
 // views + words ===============================================================
-// views are a classic string slice. words are a pre-hashed string slice.
+// views are a classic string slice. words are pre-hashed, interned strings;
+// every distinct string is stored once and identified by its `sym`. syms start
+// at 1, a zeroed Word has none.
+
+typedef uint32_t sym_t;
 
 typedef struct View {
     const char *str;
@@ -60,73 +184,78 @@ typedef union Word {
         const char *str;
         size_t len;
         hash_t hash;
+        sym_t sym;
     };
     View as_view;
 } Word;
 
 #define WORD(STR) Word_new(STR, strlen(STR))
 
+// the word interner must be initialized before any words are created. it isn't
+// locked, words can only be created on the thread that initialized it
+void words_init(void);
+void words_quit(void);
+
+// interns str if it hasn't been seen before. the returned Word's `str` is
+// owned by the interner and outlives the passed string.
 Word Word_new(const char *str, size_t len);
+// copies the Word struct, strings are never duplicated
 Word *Word_copy_of(const Word *src, Bump *pool);
 
+// compares syms, or the strings if either word has no sym
 bool Word_eq(const Word *a, const Word *b);
 bool Word_eq_view(const Word *a, const View *b);
 
-// ordered Word -> id hashmap ==================================================
+// Word -> id hashmap ==========================================================
 
 /*
- * TODO replace with a (much) faster flat version at some point. pretty sure
- * IdMap_remove isn't even used, soooo
+ * flat open-addressed table with linear probing, keyed on word syms so probing
+ * never has to chase `name` pointers. names must come from Word_new.
  */
 
-typedef struct IdMapNode {
-    struct IdMapNode *next;
-
-    const Word *name;
+typedef struct IdMapSlot {
+    const Word *name; // NULL if slot is empty
+    sym_t sym;
     unsigned id;
-} IdMapNode;
+} IdMapSlot;
 
 typedef struct IdMap {
-    IdMapNode **nodes;
-    size_t size, cap;
+    IdMapSlot *slots;
+    size_t size, cap; // cap is always a power of 2
 } IdMap;
 
 IdMap IdMap_new(void);
 void IdMap_del(IdMap *);
 
-// put does NOT copy words, assumes their lifetime is longer than IdMap
+// put does NOT copy words, assumes their lifetime is longer than IdMap. putting
+// a name that already exists replaces its id.
 void IdMap_put(IdMap *, const Word *name, unsigned id);
 
 // get will panic if name isn't found, checked allows you to handle errors
 bool IdMap_get_checked(const IdMap *, const Word *name, unsigned *out_id);
 unsigned IdMap_get(const IdMap *, const Word *name);
 
-void IdMap_remove(IdMap *, const Word *name);
+// returns whether name was found and removed
+bool IdMap_remove(IdMap *, const Word *name);
 
 void IdMap_dump(IdMap *);
 
-// put-only id set =============================================================
-
-typedef struct IdSet {
-    Vec supersets; // Vec<IdSet *>
-    unsigned *ids;
-    bool *filled;
-    size_t size, cap;
-} IdSet;
+// hash map + set ==============================================================
 
-IdSet IdSet_new(void);
-void IdSet_del(IdSet *);
-
-void IdSet_add_superset(IdSet *, IdSet *super);
-void IdSet_put(IdSet *, unsigned id);
-bool IdSet_has(const IdSet *, unsigned id);
+/*
+ * swiss table; slots are split into groups of HASHMAP_GROUP_WIDTH, and each
+ * slot has a control byte that is either empty, deleted, or 7 bits of the key
+ * hash. probing checks a whole group of control bytes at once (with SSE2 where
+ * available) and only touches keys on a hash fragment match.
+ */
 
-// put-only hash map + set =====================================================
+#define HASHMAP_GROUP_WIDTH 16
 
 typedef struct HashMap {
-    Word *keys;
+    uint8_t *ctrl;
+    Word *keys; // `str` is NULL for any slot not holding a key
     void **values;
-    size_t size, cap;
+    size_t size, tombstones, cap; // cap is a power of 2 multiple of groups
 
     bool is_set;
 } HashMap;
@@ -136,23 +265,75 @@ typedef struct HashSet { HashMap map; } HashSet;
 HashMap HashMap_new(void);
 void HashMap_del(HashMap *);
 
-// key strings are NOT copied, assumed to be owned by HashMap owner
+// key strings are NOT copied, assumed to be owned by HashMap owner. putting a
+// key that already exists replaces its value.
 void HashMap_put(HashMap *, const Word *key, void *value);
+// returns whether key was found and removed
+bool HashMap_remove(HashMap *, const Word *key);
 
 // HashMap_get panics, checked does not
 bool HashMap_get_checked(const HashMap *, const Word *key, void **o_value);
 void *HashMap_get(const HashMap *, const Word *key);
-// matches as much of the key as possible, returns length matched
-size_t HashMap_get_longest(const HashMap *, const View *key, void **o_value);
 
 HashSet HashSet_new(void);
 void HashSet_del(HashSet *);
 
 void HashSet_put(HashSet *, const Word *word);
+bool HashSet_remove(HashSet *, const Word *word);
 bool HashSet_has(const HashSet *, const Word *word);
-// matches as many chars as possible, returning length
-size_t HashSet_longest(const HashSet *, const View *word);
 
 void HashSet_print(const HashSet *);
 
+// immutable perfect hash map =================================================
+
+/*
+ * minimal perfect Word -> unsigned map, built once with hash-and-displace.
+ * lookups are a rehash of the Word's hash and one key comparison, no probing.
+ */
+
+typedef struct PerfectMap {
+    Word *keys;
+    unsigned *values;
+    size_t size;
+
+    // per-bucket seeds for the second level hash
+    uint32_t *disps;
+    size_t num_buckets;
+} PerfectMap;
+
+// keys are copied but their strings are NOT, duplicate keys are ignored
+PerfectMap PerfectMap_new(const Word *keys, const unsigned *values, size_t n);
+void PerfectMap_del(PerfectMap *);
+
+// takes a View so callers can classify strings without interning them
+bool PerfectMap_get_checked(const PerfectMap *, const View *key,
+                            unsigned *o_value);
+
+// put-only longest match trie =================================================
+
+/*
+ * byte trie stored as a flat transition table, used for maximal munch matching.
+ * control chars never get edges (they can't appear in lexemes anyways). each
+ * word put in the trie carries a nonzero value.
+ */
+
+#define TRIE_FIRST_CHAR 0x20
+#define TRIE_WIDTH (0x100 - TRIE_FIRST_CHAR)
+
+typedef struct Trie {
+    // next[node * TRIE_WIDTH + ch - TRIE_FIRST_CHAR] is the next node index.
+    // node 0 is the root, which can never be a child, so 0 also means no edge
+    uint16_t *next;
+    unsigned *values; // 0 for nodes that don't end a word
+    size_t len, cap;
+} Trie;
+
+Trie Trie_new(void);
+void Trie_del(Trie *);
+
+void Trie_put(Trie *, const Word *word, unsigned value);
+// matches as many chars as possible in a single walk, returning length and
+// writing the matched word's value to `o_value`
+size_t Trie_longest(const Trie *, const View *word, unsigned *o_value);
+
 #endif
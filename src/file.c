@@ -1,60 +1,155 @@
 #include <stdio.h>
+#include <assert.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 #include "file.h"
 
-static View read_file(const char *filepath) {
-    FILE *fp = fopen(filepath, "r");
+// for pipes and anything else that can't be mapped
+static View read_fd(int fd, const char *filepath) {
+#define READ_CHUNK 65536
+    size_t len = 0, cap = READ_CHUNK;
+    char *text = malloc(cap + 1);
 
-    if (!fp)
-        fungus_panic("could not open file \"%s\"!", filepath);
+    while (true) {
+        if (len == cap) {
+            cap *= 2;
+            text = realloc(text, cap + 1);
+        }
 
-    fseek(fp, 0, SEEK_END);
+        ssize_t n = read(fd, &text[len], cap - len);
 
-    size_t len = ftell(fp);
-    char *text = malloc(len + 1);
+        if (n < 0)
+            fungus_panic("could not read file \"%s\"!", filepath);
+        else if (n == 0)
+            break;
 
-    text[len] = '\0';
-    rewind(fp);
-    fread(text, 1, len, fp);
+        len += n;
+    }
 
-    fclose(fp);
+    text[len] = '\0';
 
     return (View){ text, len };
 }
 
-static void get_file_lines(File *f) {
-#define INIT_LINES_CAP 32
-    hsize_t cap = INIT_LINES_CAP;
+/*
+ * regular files are mapped read-only instead of copied. the text is NOT nul
+ * terminated, everything reading it must stay within text.len.
+ */
+static View read_file(const char *filepath, bool *o_mapped) {
+    int fd = open(filepath, O_RDONLY);
 
-    f->lines = malloc(cap * sizeof(*f->lines));
-    f->lines_len = 1;
-    f->lines[0] = 0;
+    if (fd < 0)
+        fungus_panic("could not open file \"%s\"!", filepath);
 
-    // count
-    const View *text = &f->text;
+    struct stat st;
+    View text = {0};
 
-    for (hsize_t i = 1; i < text->len; ++i) {
-        if (text->str[i - 1] != '\n')
-            continue;
+    *o_mapped = false;
 
-        // push a line #
-        f->lines[f->lines_len++] = i;
+    if (!fstat(fd, &st) && S_ISREG(st.st_mode) && st.st_size > 0) {
+        void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
 
-        if (f->lines_len == cap) {
-            cap *= 2;
-            f->lines = realloc(f->lines, cap * sizeof(*f->lines));
+        if (map != MAP_FAILED) {
+            text = (View){ map, st.st_size };
+            *o_mapped = true;
         }
     }
+
+    if (!*o_mapped)
+        text = read_fd(fd, filepath);
+
+    close(fd);
+
+    return text;
+}
+
+/*
+ * with SIMD, newlines are found a block at a time; the mask for a block has bit
+ * n set if block[n] is a newline. without it, or for the tail, bytes are
+ * checked one at a time
+ */
+#if defined(__AVX2__)
+#define NL_BLOCK 32
+
+static uint32_t newline_mask(const char *block) {
+    __m256i bytes = _mm256_loadu_si256((const __m256i *)block);
+
+    return _mm256_movemask_epi8(_mm256_cmpeq_epi8(bytes,
+                                                  _mm256_set1_epi8('\n')));
+}
+#elif defined(__SSE2__)
+#define NL_BLOCK 16
+
+static uint32_t newline_mask(const char *block) {
+    __m128i bytes = _mm_loadu_si128((const __m128i *)block);
+
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8('\n')));
+}
+#endif
+
+static size_t count_newlines(const char *str, size_t len) {
+    size_t count = 0, i = 0;
+
+#ifdef NL_BLOCK
+    for (; i + NL_BLOCK <= len; i += NL_BLOCK)
+        count += __builtin_popcount(newline_mask(&str[i]));
+#endif
+
+    for (; i < len; ++i)
+        count += str[i] == '\n';
+
+    return count;
+}
+
+// writes the index after each newline
+static void fill_line_starts(hsize_t *lines, const char *str, size_t len) {
+    size_t i = 0;
+
+#ifdef NL_BLOCK
+    for (; i + NL_BLOCK <= len; i += NL_BLOCK) {
+        uint32_t mask = newline_mask(&str[i]);
+
+        while (mask) {
+            *lines++ = i + __builtin_ctz(mask) + 1;
+            mask &= mask - 1;
+        }
+    }
+#endif
+
+    for (; i < len; ++i)
+        if (str[i] == '\n')
+            *lines++ = i + 1;
+}
+
+// counts lines first so the table is allocated exactly once
+static void get_file_lines(File *f) {
+    const View *text = &f->text;
+    // a newline at the very end doesn't start a line
+    size_t scan_len = text->len ? text->len - 1 : 0;
+
+    f->lines_len = 1 + count_newlines(text->str, scan_len);
+    f->lines = malloc(f->lines_len * sizeof(*f->lines));
+    f->lines[0] = 0;
+
+    fill_line_starts(&f->lines[1], text->str, scan_len);
 }
 
 File File_open(const char *filepath) {
     File f = {
         .filepath = filepath,
-        .text = read_file(filepath),
         .owns_text = true
     };
 
-    get_file_lines(&f);
+    f.text = read_file(filepath, &f.mapped);
 
     return f;
 }
@@ -90,8 +185,6 @@ File File_read_stdin(void) {
     // store read data
     f.text = (View){ str, len };
 
-    get_file_lines(&f);
-
     return f;
 }
 
@@ -101,18 +194,62 @@ File File_from_str(const char *filepath, const char *str, size_t len) {
        .text = { str, len }
    };
 
-   get_file_lines(&f);
-
    return f;
 }
 
 void File_del(File *f) {
-    if (f->owns_text)
+    if (f->mapped)
+        munmap((char *)f->text.str, f->text.len);
+    else if (f->owns_text)
         free((char *)f->text.str);
 
     free(f->lines);
 }
 
+void File_replace(File *f, size_t start, size_t old_len, const char *str,
+                  size_t len) {
+    assert(start + old_len <= f->text.len);
+
+    size_t tail = f->text.len - (start + old_len);
+    size_t new_len = f->text.len - old_len + len;
+    char *text;
+
+    if (f->owns_text && !f->mapped) {
+        text = (char *)f->text.str;
+
+        if (len < old_len)
+            memmove(&text[start + len], &text[start + old_len], tail);
+
+        text = realloc(text, new_len + 1);
+
+        if (len > old_len)
+            memmove(&text[start + len], &text[start + old_len], tail);
+    } else {
+        // borrowed or mapped text is copied out before it can be edited
+        text = malloc(new_len + 1);
+
+        memcpy(text, f->text.str, start);
+        memcpy(&text[start + len], &f->text.str[start + old_len], tail);
+
+        if (f->mapped)
+            munmap((char *)f->text.str, f->text.len);
+
+        f->owns_text = true;
+        f->mapped = false;
+    }
+
+    memcpy(&text[start], str, len);
+    text[new_len] = '\0';
+
+    f->text = (View){ text, new_len };
+
+    // line table is rebuilt on the next lookup
+    free(f->lines);
+    f->lines = NULL;
+    f->lines_len = 0;
+    f->last_line = 0;
+}
+
 const char *File_str(const File *f) {
     return f->text.str;
 }
@@ -130,19 +267,51 @@ typedef struct FileLoc {
 #define UP_ARROW   (TC_CYAN "^" TC_RESET)
 #define DOWN_ARROW (TC_CYAN "v" TC_RESET)
 
-static FileLoc loc_of(const File *f, hsize_t idx) {
-    FileLoc loc = { .lineno = f->lines_len };
+// the line table is a cache; building it doesn't change the File's contents
+static const hsize_t *File_lines(const File *f) {
+    if (!f->lines)
+        get_file_lines((File *)f);
 
-    for (size_t i = 0; i < f->lines_len; ++i) {
-        if (idx < f->lines[i]) {
-            loc.lineno = i;
-            break;
+    return f->lines;
+}
+
+static bool line_contains(const File *f, size_t line, hsize_t idx) {
+    return idx >= f->lines[line]
+        && (line + 1 == f->lines_len || idx < f->lines[line + 1]);
+}
+
+static FileLoc loc_of(const File *f, hsize_t idx) {
+    const hsize_t *lines = File_lines(f);
+    size_t line = f->last_line;
+
+    // diagnostics usually come in order, try the last line and the one after
+    // it before searching
+    if (!line_contains(f, line, idx)) {
+        if (line + 1 < f->lines_len && line_contains(f, line + 1, idx)) {
+            ++line;
+        } else {
+            // find the last line starting at or before idx
+            size_t lo = 0, hi = f->lines_len;
+
+            while (hi - lo > 1) {
+                size_t mid = lo + (hi - lo) / 2;
+
+                if (lines[mid] <= idx)
+                    lo = mid;
+                else
+                    hi = mid;
+            }
+
+            line = lo;
         }
     }
 
-    loc.charno = idx - f->lines[loc.lineno - 1] + 1;
+    ((File *)f)->last_line = line;
 
-    return loc;
+    return (FileLoc){
+        .lineno = line + 1,
+        .charno = idx - lines[line] + 1
+    };
 }
 
 // amount of characters needed to display a lineno range
@@ -159,10 +328,12 @@ static int lineno_chars(int max_no) {
 
 static void display_line(FILE *fp, const File *file, int lineno, int ln_chars) {
     // get line length
-    const char *line = &file->text.str[file->lines[lineno - 1]];
+    hsize_t line_start = file->lines[lineno - 1];
+    const char *line = &file->text.str[line_start];
+    size_t max_len = file->text.len - line_start;
     size_t len = 0;
 
-    while (line[len] && line[len] != '\n')
+    while (len < max_len && line[len] && line[len] != '\n')
         ++len;
 
     fprintf(fp, TC_DIM " %*d | " TC_RESET "%.*s\n",
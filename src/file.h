@@ -12,12 +12,15 @@ typedef struct File {
     const char *filepath;
     View text;
 
-    // a list of char indices for the beginning of each line
+    // a list of char indices for the beginning of each line. built lazily the
+    // first time a location is needed, access through File_lines()
     hsize_t *lines;
     size_t lines_len;
+    size_t last_line; // index of the line found by the previous lookup
 
     // flags
     bool owns_text;
+    bool mapped; // text is an mmap of the file, not nul terminated
 } File;
 
 File File_open(const char *filepath);
@@ -25,6 +28,11 @@ File File_read_stdin(void);
 File File_from_str(const char *filepath, const char *str, size_t len);
 void File_del(File *);
 
+// replaces `old_len` chars at `start` with `str`, taking ownership of the text
+// if the file didn't already own it
+void File_replace(File *, size_t start, size_t old_len, const char *str,
+                  size_t len);
+
 // for zig interop
 const char *File_str(const File *);
 size_t File_len(const File *);
@@ -8,13 +8,13 @@ const c = @cImport({
 });
 
 fn cBumpCreate(comptime T: type, pool: *c.Bump) *T {
-    const mem = c.Bump_alloc(pool, @sizeOf(T));
+    const mem = c.Bump_alloc_aligned(pool, @sizeOf(T), @alignOf(T));
 
     return @ptrCast(*T, @alignCast(@alignOf(T), mem));
 }
 
 fn cBumpAlloc(comptime T: type, pool: *c.Bump, n: usize) []T {
-    const mem = c.Bump_alloc(pool, n * @sizeOf(T));
+    const mem = c.Bump_alloc_aligned(pool, n * @sizeOf(T), @alignOf(T));
 
     return @ptrCast([*]T, @alignCast(@alignOf(T), mem))[0..n];
 }
@@ -29,7 +29,6 @@ pub const FirError = error {
     UnhandledEvalType,
     UnhandledAstExprType,
     UnhandledLiteralType,
-    InvalidLiteral,
 };
 
 fn sliceOfAstExpr(file: *c.File, expr: *c.AstExpr) []const u8 {
@@ -152,26 +151,19 @@ pub const Fir = struct {
                 };
             },
             c.ID_LITERAL => {
-                const slice = sliceOfAstExpr(ctx.file, expr);
-
-                errdefer {
-                    c.AstExpr_error(ctx.file, expr, "could not parse literal.");
-                }
+                // values were decoded by the lexer
+                const lit = c.AstExpr_lit(expr);
 
                 self.data = Data{
                     .lit = switch (expr.evaltype.id) {
-                        c.ID_INT => Literal{
-                            .int = std.fmt.parseInt(u64, slice, 0)
-                                catch return FirError.InvalidLiteral
-                        },
-                        c.ID_FLOAT => Literal{
-                            .float = std.fmt.parseFloat(f64, slice)
-                                catch return FirError.InvalidLiteral
-                        },
-                        c.ID_BOOL => Literal{
-                            .boolean = slice[0] == 't'
-                        },
-                        else => return FirError.UnhandledLiteralType
+                        c.ID_INT => Literal{ .int = lit.integer },
+                        c.ID_FLOAT => Literal{ .float = lit.floating },
+                        c.ID_BOOL => Literal{ .boolean = lit.boolean },
+                        else => {
+                            c.AstExpr_error(ctx.file, expr,
+                                            "unhandled literal type.");
+                            return FirError.UnhandledLiteralType;
+                        }
                     }
                 };
             },
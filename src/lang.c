@@ -1,31 +1,32 @@
+#include <assert.h>
+
 #include "lang.h"
 #include "fungus.h"
 #include "lang/ast_expr.h"
+#include "lex.h"
 #include "lex/lex_strings.h"
 
 Lang Lang_new(Word name) {
-    // copy name
-    char *copy = malloc(name.len * sizeof(*copy));
-
-    for (size_t i = 0; i < name.len; ++i)
-        copy[i] = name.str[i];
-
     return (Lang){
-        .name = { .str = copy, .len = name.len, .hash = name.hash },
+        .name = name,
         .rules = RuleTree_new(),
         .precs = Precs_new(),
         .words = HashSet_new(),
-        .syms = HashSet_new()
+        .syms = HashSet_new(),
+        .sym_trie = Trie_new()
     };
 }
 
 void Lang_del(Lang *lang) {
+    if (lang->climbable)
+        ClimbTable_del(&lang->climb);
+
+    PerfectMap_del(&lang->keywords);
+    Trie_del(&lang->sym_trie);
     HashSet_del(&lang->syms);
     HashSet_del(&lang->words);
     Precs_del(&lang->precs);
     RuleTree_del(&lang->rules);
-
-    free((char *)lang->name.str);
 }
 
 Rule Lang_legislate(Lang *lang, const File *file, Type type,
@@ -34,17 +35,15 @@ Rule Lang_legislate(Lang *lang, const File *file, Type type,
 }
 
 static void Lang_add_lxm(Lang *lang, const Word *lxm) {
-    HashSet *set = &lang->syms;
-
     switch (classify_char(lxm->str[0])) {
     case CH_ALPHA:
     case CH_UNDERSCORE:
-        set = &lang->words;
+        HashSet_put(&lang->words, lxm);
+        break;
     default:
+        HashSet_put(&lang->syms, lxm);
         break;
     }
-
-    HashSet_put(set, lxm);
 }
 
 Rule Lang_immediate_legislate(Lang *lang, Type type, Prec prec, Pattern pat) {
@@ -61,6 +60,87 @@ Rule Lang_immediate_legislate(Lang *lang, Type type, Prec prec, Pattern pat) {
     return rule;
 }
 
+// numbers every lexeme, generating the keyword table and sym trie, and hands
+// the ids out to the lexeme predicates of every rule
+static void Lang_gen_lexemes(Lang *lang) {
+    const char *bools[] = { "true", "false" };
+    size_t cap = lang->words.map.size + ARRAY_SIZE(bools);
+    Word *keys = malloc(cap * sizeof(*keys));
+    unsigned *values = malloc(cap * sizeof(*values));
+    size_t len = 0;
+    unsigned id = 0;
+
+    for (size_t i = 0; i < ARRAY_SIZE(bools); ++i) {
+        keys[len] = WORD(bools[i]);
+        values[len++] = TOK_BOOL;
+    }
+
+    for (size_t i = 0; i < lang->words.map.cap; ++i) {
+        const Word *word = &lang->words.map.keys[i];
+
+        if (word->str) {
+            keys[len] = *word;
+            values[len++] = TOK_LEXEME | ++id << KEYWORD_ID_SHIFT;
+        }
+    }
+
+    lang->keywords = PerfectMap_new(keys, values, len);
+
+    free(keys);
+    free(values);
+
+    for (size_t i = 0; i < lang->syms.map.cap; ++i) {
+        const Word *sym = &lang->syms.map.keys[i];
+
+        if (sym->str)
+            Trie_put(&lang->sym_trie, sym, ++id);
+    }
+
+    lang->num_lexemes = id;
+
+    // rule nodes point at these same predicates
+    const RuleTree *rules = &lang->rules;
+
+    for (size_t i = 0; i < rules->entries.len; ++i) {
+        if (i == rules->rule_scope.id)
+            continue;
+
+        RuleEntry *entry = rules->entries.data[i];
+
+        for (size_t j = 0; j < entry->pat.len; ++j) {
+            MatchAtom *match = &entry->pat.matches[j];
+
+            if (match->type == MATCH_LEXEME) {
+                match->lxm_id = Lang_lexeme_id(lang, match->lxm);
+                assert(match->lxm_id);
+            }
+        }
+    }
+}
+
+static void Lang_gen_climb(Lang *lang) {
+    lang->climbable = Climb_supports(&lang->rules);
+
+    if (lang->climbable) {
+        lang->climb =
+            ClimbTable_new(&lang->rules, &lang->precs, lang->num_lexemes);
+    } else if (lang->engine == PARSE_CLIMB) {
+        fungus_panic("lang %.*s has rules the climbing parser can't bind.",
+                     (int)lang->name.len, lang->name.str);
+    }
+}
+
+void Lang_immediate_crystallize(Lang *lang) {
+#ifdef DEBUG
+    lang->rules.crystallized = true;
+#endif
+
+    Lang_gen_lexemes(lang);
+    RuleTree_gen_index(&lang->rules);
+    RuleTree_gen_prec_keys(&lang->rules, &lang->precs);
+    Lang_gen_climb(lang);
+}
+
 void Lang_crystallize(Lang *lang, Names *names) {
     RuleTree_crystallize(&lang->rules, names);
 
@@ -79,18 +159,48 @@ void Lang_crystallize(Lang *lang, Names *names) {
                 Lang_add_lxm(lang, match->lxm);
         }
     }
+
+    Lang_gen_lexemes(lang);
+    RuleTree_gen_index(&lang->rules);
+    RuleTree_gen_prec_keys(&lang->rules, &lang->precs);
+    Lang_gen_climb(lang);
 }
 
 Prec Lang_make_prec(Lang *lang, Word name, Associativity assoc) {
     return Prec_define(&lang->precs, name, assoc);
 }
 
-HashSet *Lang_syms(Lang *lang) {
-    return &lang->syms;
+unsigned Lang_lexeme_id(const Lang *lang, const Word *lxm) {
+    View view = { lxm->str, lxm->len };
+    unsigned id = 0;
+
+    switch (classify_char(lxm->str[0])) {
+    case CH_ALPHA:
+    case CH_UNDERSCORE: {
+        unsigned value;
+
+        if (PerfectMap_get_checked(&lang->keywords, &view, &value)
+         && value >> KEYWORD_ID_SHIFT)
+            id = value >> KEYWORD_ID_SHIFT;
+
+        break;
+    }
+    default:
+        if (Trie_longest(&lang->sym_trie, &view, &id) != lxm->len)
+            id = 0;
+
+        break;
+    }
+
+    return id;
+}
+
+const Trie *Lang_sym_trie(const Lang *lang) {
+    return &lang->sym_trie;
 }
 
-HashSet *Lang_words(Lang *lang) {
-    return &lang->words;
+const PerfectMap *Lang_keywords(const Lang *lang) {
+    return &lang->keywords;
 }
 
 void Lang_dump(const Lang *lang) {
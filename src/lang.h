@@ -3,11 +3,18 @@
 
 #include "lang/rules.h"
 #include "lang/precedence.h"
+#include "lang/climb.h"
 
 /*
  * Lang stores language info, and is used during AST parsing
  */
 
+// how `parse` collapses a scope: PARSE_SWEEP sweeps it prec by prec, and
+// PARSE_CLIMB builds it left to right with precedence climbing
+typedef enum ParseEngine { PARSE_SWEEP, PARSE_CLIMB } ParseEngine;
+
+#define KEYWORD_ID_SHIFT 8
+
 // TODO could unify allocators into one Bump?
 typedef struct Lang {
     Word name;
@@ -15,7 +22,18 @@ typedef struct Lang {
     RuleTree rules;
     Precs precs;
 
+    // PARSE_SWEEP unless set. a climbable lang can switch engines at any time
+    ParseEngine engine;
+    bool climbable;
+    ClimbTable climb; // only if climbable
+
+    // lexemes are numbered 1 through num_lexemes during crystallization, so
+    // tokens and rule predicates can compare them by id
     HashSet words, syms;
+    Trie sym_trie; // syms -> id, for maximal munch splitting in the lexer
+    // words -> the TokType they lex as, with their id above KEYWORD_ID_SHIFT
+    PerfectMap keywords;
+    unsigned num_lexemes;
 } Lang;
 
 Lang Lang_new(Word name);
@@ -26,10 +44,15 @@ Rule Lang_legislate(Lang *, const File *, Type type, Prec prec,
 Rule Lang_immediate_legislate(Lang *, Type type, Prec prec, Pattern pat);
 Prec Lang_make_prec(Lang *, Word name, Associativity assoc);
 void Lang_crystallize(Lang *, Names *);
+// crystallize without compiling rules, for langs using immediate legislation
+void Lang_immediate_crystallize(Lang *);
+
+// id of a word or sym in this lang, 0 if it isn't one
+unsigned Lang_lexeme_id(const Lang *, const Word *lxm);
 
 // for zig
-HashSet *Lang_syms(Lang *);
-HashSet *Lang_words(Lang *);
+const Trie *Lang_sym_trie(const Lang *);
+const PerfectMap *Lang_keywords(const Lang *);
 
 void Lang_dump(const Lang *);
 
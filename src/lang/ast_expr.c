@@ -137,6 +137,10 @@ AstExprTok AstExpr_tok(const AstExpr *expr) {
     };
 }
 
+TokLit AstExpr_lit(const AstExpr *expr) {
+    return expr->lit;
+}
+
 AstExprRule AstExpr_rule(const AstExpr *expr) {
     return (AstExprRule){
         .rule = expr->rule,
@@ -3,6 +3,7 @@
 
 #include "rules.h"
 #include "../file.h"
+#include "../lex.h"
 #include "../sema/types.h"
 
 typedef struct Lang Lang;
@@ -18,6 +19,7 @@ typedef struct AstExpr {
         // for atoms
         struct {
             hsize_t tok_start, tok_len;
+            TokLit lit; // decoded value of literal tokens
         };
 
         // for rules (rules include all composite AST nodes)
@@ -49,6 +51,7 @@ typedef struct AstExprRule {
 } AstExprRule;
 
 AstExprTok AstExpr_tok(const AstExpr *);
+TokLit AstExpr_lit(const AstExpr *);
 AstExprRule AstExpr_rule(const AstExpr *);
 
 #endif
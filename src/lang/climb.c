@@ -0,0 +1,155 @@
+#include <assert.h>
+
+#include "climb.h"
+
+typedef enum ClimbShape {
+    CLIMB_PREFIX,
+    CLIMB_INFIX,
+    CLIMB_CHAIN
+} ClimbShape;
+
+// parse_scope extends these backwards, which a single pass can't do
+static bool climbable(const RuleEntry *entry) {
+    const MatchAtom *lead = &entry->pat.matches[0];
+
+    return lead->type == MATCH_LEXEME || !(lead->optional || lead->repeating);
+}
+
+bool Climb_supports(const RuleTree *rt) {
+    for (size_t i = 0; i < rt->entries.len; ++i)
+        if (i != rt->rule_scope.id && !climbable(rt->entries.data[i]))
+            return false;
+
+    return true;
+}
+
+static ClimbShape shape_of(const RuleEntry *entry) {
+    const Pattern *pat = &entry->pat;
+
+    assert(climbable(entry));
+
+    if (pat->matches[0].type == MATCH_LEXEME)
+        return CLIMB_PREFIX;
+
+    if (pat->len > 1 && pat->matches[1].type == MATCH_LEXEME)
+        return CLIMB_INFIX;
+
+    return CLIMB_CHAIN;
+}
+
+static unsigned key_of(const RuleEntry *entry, ClimbShape shape) {
+    return entry->pat.matches[shape == CLIMB_PREFIX ? 0 : 1].lxm_id;
+}
+
+static ClimbRule ClimbRule_of(const RuleTree *rt, const Precs *precs,
+                              size_t id) {
+    const RuleEntry *entry = rt->entries.data[id];
+    size_t max_len = entry->pat.len;
+
+    for (size_t i = 0; i < entry->pat.len; ++i)
+        if (entry->pat.matches[i].repeating)
+            max_len = SIZE_MAX;
+
+    return (ClimbRule){
+        .rule = { id },
+        .pat = &entry->pat,
+        .prec = entry->prec.id,
+        .right = Prec_assoc(precs, entry->prec) == ASSOC_RIGHT,
+        .max_len = max_len
+    };
+}
+
+static bool contested(const ClimbRule *rules, size_t len) {
+    for (size_t i = 1; i < len; ++i)
+        if (rules[i].prec != rules[0].prec)
+            return true;
+
+    return false;
+}
+
+// contested flags for each key filed by file_by_key
+static bool *contested_keys(const ClimbRule *rules, const unsigned *offsets,
+                            unsigned num_lexemes) {
+    size_t num_keys = num_lexemes + 1;
+    bool *flags = malloc(num_keys * sizeof(*flags));
+
+    for (size_t i = 0; i < num_keys; ++i)
+        flags[i] = contested(&rules[offsets[i]], offsets[i + 1] - offsets[i]);
+
+    return flags;
+}
+
+// files the rules of a keyed shape by lexeme id, in rule order, and returns
+// the offsets
+static unsigned *file_by_key(const RuleTree *rt, const Precs *precs,
+                             unsigned num_lexemes, ClimbShape shape,
+                             ClimbRule **o_rules) {
+    size_t num_keys = num_lexemes + 1;
+    unsigned *offsets = calloc(num_keys + 1, sizeof(*offsets));
+
+    for (size_t i = 0; i < rt->entries.len; ++i) {
+        const RuleEntry *entry = rt->entries.data[i];
+
+        if (i != rt->rule_scope.id && shape_of(entry) == shape)
+            ++offsets[key_of(entry, shape) + 1];
+    }
+
+    for (size_t i = 0; i < num_keys; ++i)
+        offsets[i + 1] += offsets[i];
+
+    // place rules, using the start of each key as its cursor
+    ClimbRule *rules = malloc(offsets[num_keys] * sizeof(*rules));
+
+    for (size_t i = 0; i < rt->entries.len; ++i) {
+        const RuleEntry *entry = rt->entries.data[i];
+
+        if (i != rt->rule_scope.id && shape_of(entry) == shape)
+            rules[offsets[key_of(entry, shape)]++] = ClimbRule_of(rt, precs, i);
+    }
+
+    // cursors now sit at the start of the next key
+    for (size_t i = num_keys; i > 0; --i)
+        offsets[i] = offsets[i - 1];
+
+    offsets[0] = 0;
+
+    *o_rules = rules;
+
+    return offsets;
+}
+
+ClimbTable ClimbTable_new(const RuleTree *rt, const Precs *precs,
+                          unsigned num_lexemes) {
+    ClimbTable t = {0};
+
+    t.prefix_offsets =
+        file_by_key(rt, precs, num_lexemes, CLIMB_PREFIX, &t.prefix);
+    t.infix_offsets =
+        file_by_key(rt, precs, num_lexemes, CLIMB_INFIX, &t.infix);
+    t.prefix_contested =
+        contested_keys(t.prefix, t.prefix_offsets, num_lexemes);
+    t.infix_contested = contested_keys(t.infix, t.infix_offsets, num_lexemes);
+
+    t.chains = malloc(rt->entries.len * sizeof(*t.chains));
+
+    for (size_t i = 0; i < rt->entries.len; ++i) {
+        const RuleEntry *entry = rt->entries.data[i];
+
+        if (i != rt->rule_scope.id && shape_of(entry) == CLIMB_CHAIN)
+            t.chains[t.chains_len++] = ClimbRule_of(rt, precs, i);
+    }
+
+    t.chains_contested = contested(t.chains, t.chains_len);
+
+    return t;
+}
+
+void ClimbTable_del(ClimbTable *t) {
+    free(t->prefix);
+    free(t->infix);
+    free(t->prefix_offsets);
+    free(t->infix_offsets);
+    free(t->prefix_contested);
+    free(t->infix_contested);
+    free(t->chains);
+}
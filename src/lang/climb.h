@@ -0,0 +1,76 @@
+#ifndef CLIMB_H
+#define CLIMB_H
+
+#include "rules.h"
+#include "precedence.h"
+
+/*
+ * ClimbTable holds the binding info for the precedence climbing parser,
+ * derived from a RuleTree and its Precs when a Lang crystallizes. rules are
+ * filed by shape:
+ * - prefix rules start with a lexeme, and are keyed on it
+ * - infix rules (postfix operators included) follow their lead expr with a
+ *   lexeme, and are keyed on that
+ * - chain rules follow their lead expr with more exprs, like `If Elif?* Else?`
+ * a rule's binding power is its prec, higher binds tighter. a key is
+ * contested when it files rules of more than one prec. rules under an
+ * uncontested key never block each other (see climb_blocked in parse.c).
+ */
+
+typedef struct ClimbRule {
+    Rule rule;
+    const Pattern *pat;
+    unsigned prec;
+    bool right; // right associative
+    size_t max_len; // most exprs it can span, SIZE_MAX if it repeats
+} ClimbRule;
+
+typedef struct ClimbRules {
+    const ClimbRule *rules;
+    size_t len;
+    bool contested;
+} ClimbRules;
+
+typedef struct ClimbTable {
+    // rules keyed on lexeme id `i` are [offsets[i], offsets[i + 1])
+    ClimbRule *prefix, *infix;
+    unsigned *prefix_offsets, *infix_offsets;
+    bool *prefix_contested, *infix_contested;
+
+    ClimbRule *chains;
+    size_t chains_len;
+    bool chains_contested;
+} ClimbTable;
+
+// whether every rule has a shape the climbing parser can bind. rules leading
+// with an optional or repeating expr are only parsed by parse_scope
+bool Climb_supports(const RuleTree *);
+ClimbTable ClimbTable_new(const RuleTree *, const Precs *,
+                          unsigned num_lexemes);
+void ClimbTable_del(ClimbTable *);
+
+static inline ClimbRules Climb_prefix(const ClimbTable *t, unsigned lxm_id) {
+    unsigned start = t->prefix_offsets[lxm_id];
+
+    return (ClimbRules){
+        &t->prefix[start],
+        t->prefix_offsets[lxm_id + 1] - start,
+        t->prefix_contested[lxm_id]
+    };
+}
+
+static inline ClimbRules Climb_infix(const ClimbTable *t, unsigned lxm_id) {
+    unsigned start = t->infix_offsets[lxm_id];
+
+    return (ClimbRules){
+        &t->infix[start],
+        t->infix_offsets[lxm_id + 1] - start,
+        t->infix_contested[lxm_id]
+    };
+}
+
+static inline ClimbRules Climb_chains(const ClimbTable *t) {
+    return (ClimbRules){ t->chains, t->chains_len, t->chains_contested };
+}
+
+#endif
@@ -90,7 +90,7 @@ void pattern_lang_init(Names *names) {
                          TypeExpr_atom(p, fun_opt_match));
 
         len = 3;
-        matches = Bump_alloc(p, len * sizeof(*matches));
+        matches = BUMP_ARRAY(p, MatchAtom, len);
         matches[0] = new_match_expr(p, TypeExpr_atom(p, fun_ident),
                                     TypeExpr_atom(p, fun_unknown), 0);
         matches[1] = new_match_lxm(p, ":");
@@ -105,7 +105,7 @@ void pattern_lang_init(Names *names) {
 
         // type or
         len = 3;
-        matches = Bump_alloc(p, len * sizeof(*matches));
+        matches = BUMP_ARRAY(p, MatchAtom, len);
         matches[0] = new_match_expr(p, TypeExpr_atom(p, fun_any_expr),
                                     TypeExpr_atom(p, fun_type), 0);
         matches[1] = new_match_lxm(p, "|");
@@ -120,7 +120,7 @@ void pattern_lang_init(Names *names) {
 
         // type bang
         len = 3;
-        matches = Bump_alloc(p, len * sizeof(*matches));
+        matches = BUMP_ARRAY(p, MatchAtom, len);
         matches[0] = new_match_expr(p, TypeExpr_atom(p, fun_any_expr),
                                     TypeExpr_atom(p, fun_type), 0);
         matches[1] = new_match_lxm(p, "!");
@@ -135,7 +135,7 @@ void pattern_lang_init(Names *names) {
 
         // optional modifier
         len = 2;
-        matches = Bump_alloc(p, len * sizeof(*matches));
+        matches = BUMP_ARRAY(p, MatchAtom, len);
         matches[0] = new_match_expr(p, match_expr_types,
                                     TypeExpr_atom(p, fun_match), 0);
         matches[1] = new_match_lxm(p, "?");
@@ -148,7 +148,7 @@ void pattern_lang_init(Names *names) {
 
         // repeating modifier
         len = 2;
-        matches = Bump_alloc(p, len * sizeof(*matches));
+        matches = BUMP_ARRAY(p, MatchAtom, len);
         matches[0] = new_match_expr(p, match_expr_types,
                                     TypeExpr_atom(p, fun_match), 0);
         matches[1] = new_match_lxm(p, "*");
@@ -161,7 +161,7 @@ void pattern_lang_init(Names *names) {
 
         // return type
         len = 2;
-        matches = Bump_alloc(p, len * sizeof(*matches));
+        matches = BUMP_ARRAY(p, MatchAtom, len);
         matches[0] = new_match_lxm(p, "->");
         matches[1] = new_match_expr(p, TypeExpr_atom(p, fun_any_expr),
                                     TypeExpr_atom(p, fun_type), 0);
@@ -174,7 +174,7 @@ void pattern_lang_init(Names *names) {
 
         // where clause
         len = 3;
-        matches = Bump_alloc(p, len * sizeof(*matches));
+        matches = BUMP_ARRAY(p, MatchAtom, len);
         matches[0] = new_match_expr(p, TypeExpr_atom(p, fun_ident),
                                     TypeExpr_atom(p, fun_unknown), 0);
         matches[1] = new_match_lxm(p, "=");
@@ -189,7 +189,7 @@ void pattern_lang_init(Names *names) {
 
         // where clause series
         len = 2;
-        matches = Bump_alloc(p, len * sizeof(*matches));
+        matches = BUMP_ARRAY(p, MatchAtom, len);
         matches[0] = new_match_lxm(p, "where");
         matches[1] = new_match_expr(p, TypeExpr_atom(p, fun_wh_clause),
                                     TypeExpr_atom(p, fun_wh_clause),
@@ -203,7 +203,7 @@ void pattern_lang_init(Names *names) {
 
         // pattern
         len = 3;
-        matches = Bump_alloc(p, len * sizeof(*matches));
+        matches = BUMP_ARRAY(p, MatchAtom, len);
 
         const TypeExpr *expr_or_lxm =
             TypeExpr_sum(p, 2,
@@ -229,9 +229,7 @@ void pattern_lang_init(Names *names) {
         });
     }
 
-#ifdef DEBUG
-    lang.rules.crystallized = true; // TODO this is ugly
-#endif
+    Lang_immediate_crystallize(&lang);
     pattern_lang = lang;
 
     DEBUG_SCOPE(0,
@@ -243,15 +241,13 @@ void pattern_lang_quit(void) {
     Lang_del(&pattern_lang);
 }
 
-bool MatchAtom_matches_rule(const File *file, const MatchAtom *pred,
-                            const AstExpr *expr) {
+bool MatchAtom_matches_rule(const MatchAtom *pred, const AstExpr *expr) {
     bool matches = false;
 
     if (expr->type.id == fun_lexeme.id) {
-        // lexeme
-        View token = { &file->text.str[expr->tok_start], expr->tok_len };
-
-        matches = pred->type == MATCH_LEXEME && Word_eq_view(pred->lxm, &token);
+        // lexeme; tokens and predicates share the Lang's ids
+        matches = pred->type == MATCH_LEXEME
+               && pred->lxm_id == expr->lit.lexeme;
     } else {
         // expr
         matches = pred->type == MATCH_EXPR
@@ -261,8 +257,7 @@ bool MatchAtom_matches_rule(const File *file, const MatchAtom *pred,
     return matches;
 }
 
-bool MatchAtom_matches_type(const File *file, const MatchAtom *pred,
-                            const AstExpr *expr) {
+bool MatchAtom_matches_type(const MatchAtom *pred, const AstExpr *expr) {
     if (pred->type == MATCH_LEXEME)
         return true;
 
@@ -297,8 +292,7 @@ File pattern_file(const char *str) {
 
 AstExpr *precompile_pattern(Bump *pool, Names *names, const File *file) {
     // create ast
-    TokBuf tokens = TokBuf_new();
-    lex(&tokens, file, &pattern_lang, 0, file->text.len);
+    TokBuf tokens = lex(pool, file, &pattern_lang, 0, file->text.len);
 
     AstExpr *ast = parse(&(AstCtx){
         .pool = pool,
@@ -398,7 +392,7 @@ static WhereClause compile_where_clause(Bump *pool, const Names *names,
     }
 
     // copy constrains
-    size_t *pooled_constrains = Bump_alloc(pool, con_len * sizeof(*constrains));
+    size_t *pooled_constrains = BUMP_ARRAY(pool, size_t, con_len);
 
     for (size_t i = 0; i < con_len; ++i)
         pooled_constrains[i] = constrains[i];
@@ -493,7 +487,7 @@ Pattern compile_pattern(Bump *pool, Names *names, const File *file,
 
     if (where_expr->type.id == fun_where.id) {
         pat.wheres_len = where_expr->len - 1;
-        pat.wheres = Bump_alloc(pool, pat.wheres_len * sizeof(*pat.wheres));
+        pat.wheres = BUMP_ARRAY(pool, WhereClause, pat.wheres_len);
 
         for (size_t i = 1; i < where_expr->len; ++i) {
             WhereClause *clause = &pat.wheres[i - 1];
@@ -507,7 +501,7 @@ Pattern compile_pattern(Bump *pool, Names *names, const File *file,
     }
 
     // parse match atoms
-    pat.matches = Bump_alloc(pool, pat.len * sizeof(*pat.matches));
+    pat.matches = BUMP_ARRAY(pool, MatchAtom, pat.len);
 
     for (size_t i = 0; i < pat.len; ++i) {
         compile_match_atom(&pat.matches[i], pool, names, file,
@@ -27,8 +27,11 @@ typedef struct MatchAtom {
             bool optional;
         };
 
-        // lexeme
-        const Word *lxm;
+        // lexeme; id is assigned when the Lang crystallizes
+        struct {
+            const Word *lxm;
+            unsigned lxm_id;
+        };
     };
 } MatchAtom;
 
@@ -62,8 +65,8 @@ AstExpr *precompile_pattern(Bump *, Names *names, const File *file);
 Pattern compile_pattern(Bump *, Names *names, const File *file,
                         const AstExpr *ast);
 
-bool MatchAtom_matches_rule(const File *, const MatchAtom *, const AstExpr *);
-bool MatchAtom_matches_type(const File *, const MatchAtom *, const AstExpr *);
+bool MatchAtom_matches_rule(const MatchAtom *, const AstExpr *);
+bool MatchAtom_matches_type(const MatchAtom *, const AstExpr *);
 bool MatchAtom_equals(const MatchAtom *, const MatchAtom *);
 
 void MatchAtom_print(const MatchAtom *);
@@ -4,16 +4,12 @@
 #include "ast_expr.h"
 #include "../fungus.h"
 
-static void *RT_alloc(RuleTree *rt, size_t n_bytes) {
-    return Bump_alloc(&rt->pool, n_bytes);
-}
-
 static RuleNode *RT_new_node(RuleTree *rt, MatchAtom *pred) {
-    RuleNode *node = RT_alloc(rt, sizeof(*node));
+    RuleNode *node = BUMP_NEW(&rt->pool, RuleNode);
 
     *node = (RuleNode){
         .pred = pred,
-        .nexts = Vec_new()
+        .nexts = RuleNodeVec_new()
     };
 
     return node;
@@ -36,10 +32,10 @@ RuleTree RuleTree_new(void) {
         .by_name = IdMap_new(),
     };
 
-    rt.roots = Vec_new();
+    rt.roots = RuleNodeVec_new();
 
     // Scope rule
-    RuleEntry *scope_entry = RT_alloc(&rt, sizeof(*scope_entry));
+    RuleEntry *scope_entry = BUMP_NEW(&rt.pool, RuleEntry);
     Word name = WORD("Scope");
 
     *scope_entry = (RuleEntry){
@@ -53,26 +49,28 @@ RuleTree RuleTree_new(void) {
 }
 
 static void RuleNode_del(RuleNode *node) {
-    for (size_t i = 0; i < node->nexts.len; ++i) {
-        RuleNode *child = node->nexts.data[i];
+    RuleNode **children = RuleNodeVec_data(&node->nexts);
 
-        if (child != node)
-            RuleNode_del(child);
-    }
+    for (size_t i = 0; i < node->nexts.len; ++i)
+        if (children[i] != node)
+            RuleNode_del(children[i]);
 
-    Vec_del(&node->nexts);
+    RuleNodeVec_del(&node->nexts);
 }
 
 void RuleTree_del(RuleTree *rt) {
+    RuleNode **roots = RuleNodeVec_data(&rt->roots);
+
     for (size_t i = 0; i < rt->roots.len; ++i)
-        RuleNode_del(rt->roots.data[i]);
+        RuleNode_del(roots[i]);
 
+    RuleNodeVec_del(&rt->roots);
     IdMap_del(&rt->by_name);
     Vec_del(&rt->entries);
     Bump_del(&rt->pool);
 }
 
-static void place_rule_r(RuleTree *rt, RuleNode *node, Vec *nexts,
+static void place_rule_r(RuleTree *rt, RuleNode *node, RuleNodeVec *nexts,
                          const Pattern *pat, size_t index, Rule rule) {
     assert(index <= pat->len);
 
@@ -95,7 +93,7 @@ static void place_rule_r(RuleTree *rt, RuleNode *node, Vec *nexts,
         place_rule_r(rt, node, nexts, pat, index + 1, rule);
 
     for (size_t i = 0; i < nexts->len; ++i) {
-        RuleNode *next = nexts->data[i];
+        RuleNode *next = RuleNodeVec_data(nexts)[i];
         bool matching = false;
 
         if (pred->type == next->pred->type) {
@@ -119,11 +117,11 @@ static void place_rule_r(RuleTree *rt, RuleNode *node, Vec *nexts,
     // no match found, create a new node
     if (!place) {
         place = RT_new_node(rt, pred);
-        Vec_push(nexts, place); // TODO copy predicate here to ruletree pool
+        RuleNodeVec_push(nexts, place); // TODO copy predicate here to ruletree pool
 
         // apply repeating flag, if set
         if (pred->type == MATCH_EXPR && pred->repeating)
-            Vec_push(&place->nexts, place);
+            RuleNodeVec_push(&place->nexts, place);
     }
 
     // recur
@@ -139,7 +137,7 @@ Type Rule_define_type(Names *names, Word name) {
 }
 
 Rule Rule_immediate_define(RuleTree *rt, Type type, Prec prec, Pattern pat) {
-    RuleEntry *entry = RT_alloc(rt, sizeof(*entry));
+    RuleEntry *entry = BUMP_NEW(&rt->pool, RuleEntry);
 
     *entry = (RuleEntry){
         .name = Word_copy_of(Type_name(type), &rt->pool),
@@ -159,7 +157,7 @@ Rule Rule_define(RuleTree *rt, const File *file, Type type, Prec prec,
                  AstExpr *pat_ast) {
     assert(file && pat_ast);
 
-    RuleEntry *entry = RT_alloc(rt, sizeof(*entry));
+    RuleEntry *entry = BUMP_NEW(&rt->pool, RuleEntry);
 
     *entry = (RuleEntry){
         .name = Word_copy_of(Type_name(type), &rt->pool),
@@ -194,6 +192,207 @@ void RuleTree_crystallize(RuleTree *rt, Names *names) {
 #endif
 }
 
+static RuleIndex RuleIndex_new(RuleTree *rt, const RuleNodeVec *nexts,
+                               size_t num_types) {
+    RuleNode **nodes = RuleNodeVec_data(nexts);
+    RuleIndex index = {0};
+    size_t num_lxms = 0;
+
+    for (size_t i = 0; i < nexts->len; ++i) {
+        if (nodes[i]->pred->type == MATCH_LEXEME)
+            ++num_lxms;
+        else
+            ++index.num_exprs;
+    }
+
+    // lexemes
+    if (num_lxms) {
+        size_t cap = 2;
+
+        while (cap < num_lxms * 2)
+            cap *= 2;
+
+        index.lxm_ids = BUMP_ARRAY(&rt->pool, unsigned, cap);
+        index.lxm_nodes = BUMP_ARRAY(&rt->pool, RuleNode *, cap);
+        index.lxm_mask = cap - 1;
+
+        memset(index.lxm_ids, 0, cap * sizeof(*index.lxm_ids));
+
+        for (size_t i = 0; i < nexts->len; ++i) {
+            if (nodes[i]->pred->type != MATCH_LEXEME)
+                continue;
+
+            unsigned id = nodes[i]->pred->lxm_id;
+            unsigned slot = id & index.lxm_mask;
+
+            assert(id);
+
+            while (index.lxm_ids[slot])
+                slot = (slot + 1) & index.lxm_mask;
+
+            index.lxm_ids[slot] = id;
+            index.lxm_nodes[slot] = nodes[i];
+        }
+    }
+
+    // exprs
+    index.exprs = BUMP_ARRAY(&rt->pool, RuleNode *, index.num_exprs);
+
+    for (size_t i = 0, j = 0; i < nexts->len; ++i)
+        if (nodes[i]->pred->type == MATCH_EXPR)
+            index.exprs[j++] = nodes[i];
+
+    if (index.num_exprs > 1) {
+        unsigned *offsets = BUMP_ARRAY(&rt->pool, unsigned, num_types + 1);
+        size_t total = 0;
+
+        for (size_t t = 0; t < num_types; ++t) {
+            offsets[t] = total;
+
+            for (size_t i = 0; i < index.num_exprs; ++i)
+                if (Type_matches((Type){ t }, index.exprs[i]->pred->rule_expr))
+                    ++total;
+        }
+
+        offsets[num_types] = total;
+
+        RuleNode **type_nodes = BUMP_ARRAY(&rt->pool, RuleNode *, total);
+
+        for (size_t t = 0, j = 0; t < num_types; ++t) {
+            for (size_t i = 0; i < index.num_exprs; ++i) {
+                RuleNode *node = index.exprs[i];
+
+                if (Type_matches((Type){ t }, node->pred->rule_expr))
+                    type_nodes[j++] = node;
+            }
+        }
+
+        index.type_offsets = offsets;
+        index.type_nodes = type_nodes;
+        index.num_types = num_types;
+    }
+
+    return index;
+}
+
+static void index_children_r(RuleTree *rt, RuleNode *node, size_t num_types) {
+    RuleNode **children = RuleNodeVec_data(&node->nexts);
+
+    node->index = RuleIndex_new(rt, &node->nexts, num_types);
+
+    for (size_t i = 0; i < node->nexts.len; ++i)
+        if (children[i] != node)
+            index_children_r(rt, children[i], num_types);
+}
+
+void RuleTree_gen_index(RuleTree *rt) {
+    // AST exprs are atoms or rules, so only their type ids need entries
+    unsigned max_type = MAX(MAX(fun_lexeme.id, fun_literal.id),
+                            MAX(fun_ident.id, fun_scope.id));
+
+    for (size_t i = 0; i < rt->entries.len; ++i) {
+        const RuleEntry *entry = rt->entries.data[i];
+
+        max_type = MAX(max_type, entry->type.id);
+    }
+
+    size_t num_types = max_type + 1;
+    RuleNode **roots = RuleNodeVec_data(&rt->roots);
+
+    rt->root_index = RuleIndex_new(rt, &rt->roots, num_types);
+
+    for (size_t i = 0; i < rt->roots.len; ++i)
+        index_children_r(rt, roots[i], num_types);
+}
+
+void RuleTree_gen_prec_keys(RuleTree *rt, const Precs *precs) {
+    PrecKeys *keys = &rt->prec_keys;
+    size_t len = 0;
+
+    // every rule has at most one key
+    keys->offsets = BUMP_ARRAY(&rt->pool, unsigned, precs->len + 1);
+    keys->lxm_ids = BUMP_ARRAY(&rt->pool, unsigned, rt->entries.len);
+    keys->max_lead = BUMP_ARRAY(&rt->pool, unsigned, precs->len);
+
+    for (size_t p = 0; p < precs->len; ++p) {
+        keys->offsets[p] = len;
+        keys->max_lead[p] = 0;
+
+        for (size_t i = 0; i < rt->entries.len; ++i) {
+            const RuleEntry *entry = rt->entries.data[i];
+
+            if (i == rt->rule_scope.id || entry->prec.id != p)
+                continue;
+
+            // find key
+            const MatchAtom *matches = entry->pat.matches;
+            size_t lead = 0;
+
+            while (lead < entry->pat.len
+                && matches[lead].type == MATCH_EXPR
+                && !matches[lead].repeating)
+                ++lead;
+
+            if (lead == entry->pat.len || matches[lead].type != MATCH_LEXEME) {
+                keys->max_lead[p] = PREC_UNKEYED;
+                continue;
+            }
+
+            if (keys->max_lead[p] != PREC_UNKEYED)
+                keys->max_lead[p] = MAX(keys->max_lead[p], lead);
+
+            // file key, once per prec
+            unsigned id = matches[lead].lxm_id;
+            size_t j = keys->offsets[p];
+
+            while (j < len && keys->lxm_ids[j] != id)
+                ++j;
+
+            if (j == len)
+                keys->lxm_ids[len++] = id;
+        }
+    }
+
+    keys->offsets[precs->len] = len;
+}
+
+size_t RuleIndex_get(const RuleIndex *index, const AstExpr *expr,
+                     RuleNode *const **o_nodes) {
+    if (expr->type.id == fun_lexeme.id) {
+        if (!index->lxm_ids)
+            return 0;
+
+        unsigned id = expr->lit.lexeme;
+        unsigned slot = id & index->lxm_mask;
+
+        while (index->lxm_ids[slot]) {
+            if (index->lxm_ids[slot] == id) {
+                *o_nodes = &index->lxm_nodes[slot];
+                return 1;
+            }
+
+            slot = (slot + 1) & index->lxm_mask;
+        }
+
+        return 0;
+    }
+
+    unsigned id = expr->type.id;
+
+    if (id < index->num_types) {
+        unsigned start = index->type_offsets[id];
+
+        *o_nodes = &index->type_nodes[start];
+
+        return index->type_offsets[id + 1] - start;
+    }
+
+    // few enough children to test directly
+    *o_nodes = index->exprs;
+
+    return index->num_exprs;
+}
+
 Type Rule_typeof(const RuleTree *rt, Rule rule) {
     return Rule_get(rt, rule)->type;
 }
@@ -212,11 +411,11 @@ const RuleEntry *Rule_get(const RuleTree *rt, Rule rule) {
 
 #define INDENT 2
 
-static void dump_children(const RuleTree *rt, const Vec *children,
+static void dump_children(const RuleTree *rt, const RuleNodeVec *children,
                           const RuleNode *exclude, int level) {
     // print matches
     for (size_t i = 0; i < children->len; ++i) {
-        const RuleNode *child = children->data[i];
+        const RuleNode *child = RuleNodeVec_data(children)[i];
 
         if (child == exclude)
             continue;
@@ -2,6 +2,7 @@
 #define RULES_H
 
 #include <stddef.h>
+#include <limits.h>
 
 #include "precedence.h"
 #include "pattern.h"
@@ -29,22 +30,73 @@ typedef struct RuleEntry {
     Type type;
 } RuleEntry;
 
-typedef struct RuleNode {
+typedef struct RuleNode RuleNode;
+
+// most nodes only fan out to a couple of children
+SMALLVEC(RuleNodeVec, RuleNode *, 4)
+
+/*
+ * dispatch index over a RuleNodeVec, so matching only tests the children
+ * which can take the expr at hand. lexeme children are open addressed by
+ * lexeme id (0 marks an empty slot). expr children keep their order, and when
+ * there are several, the ones taking each AST type id are
+ * [type_offsets[id], type_offsets[id + 1]) of type_nodes
+ */
+typedef struct RuleIndex {
+    unsigned *lxm_ids;
+    RuleNode **lxm_nodes;
+    unsigned lxm_mask;
+
+    RuleNode **exprs;
+    size_t num_exprs;
+
+    unsigned *type_offsets;
+    RuleNode **type_nodes;
+    size_t num_types;
+} RuleIndex;
+
+/*
+ * the lexemes each prec's rules are keyed on, so parse_scope can skip precs
+ * which can't match in a scope. a rule's key is its first lexeme, which is
+ * at most max_lead[prec] exprs into a match. a prec with a rule that has no
+ * key, or a repeating expr before it, is PREC_UNKEYED.
+ * prec `p` is keyed on lxm_ids [offsets[p], offsets[p + 1])
+ */
+typedef struct PrecKeys {
+    unsigned *offsets;
+    unsigned *lxm_ids;
+    unsigned *max_lead;
+} PrecKeys;
+
+/*
+ * the sweeps rely on this invariant for keyed precs: everything before a
+ * rule's key is a single non-repeating expr predicate, and each one matches
+ * exactly one expr of the scope. lexemes can't be optional, so a match which
+ * has its key at position `key` starts within [key - lead, key], where `lead`
+ * is max_lead[prec]. optional leads can only move the start toward the key.
+ * a repeating lead could start any distance back, so its prec is unkeyed.
+ */
+#define PREC_UNKEYED UINT_MAX
+
+struct RuleNode {
     // TODO RuleNode only really uses the rule expr of the MatchAtom, shouldn't
     // I just store that instead of the whole thing?
     MatchAtom *pred;
-    Vec nexts;
+    RuleNodeVec nexts;
+    RuleIndex index; // over nexts
 
     // rule
     Rule rule;
     bool has_rule;
-} RuleNode;
+};
 
 typedef struct RuleTree {
     Bump pool;
     Vec entries; // entries[0] represents Scope, never contains an actual entry
     IdMap by_name;
-    Vec roots; // Vec<RuleNode *>
+    RuleNodeVec roots;
+    RuleIndex root_index;
+    PrecKeys prec_keys;
 
     // 'constants'; available for every Lang
     Rule rule_scope;
@@ -68,6 +120,15 @@ Rule Rule_define(RuleTree *, const File *, Type type, Prec prec,
                  AstExpr *pat_ast);
 // second phase: compiling + applying queued definitions
 void RuleTree_crystallize(RuleTree *, Names *);
+// indexes every node's children, once lexeme predicates have their ids
+void RuleTree_gen_index(RuleTree *);
+
+// files the key lexemes of every prec, once lexeme predicates have their ids
+void RuleTree_gen_prec_keys(RuleTree *, const Precs *);
+
+// children of `index` which could match `expr`, returns how many
+size_t RuleIndex_get(const RuleIndex *, const AstExpr *expr,
+                     RuleNode *const **o_nodes);
 
 Type Rule_typeof(const RuleTree *, Rule rule);
 Rule Rule_by_name(const RuleTree *, const Word *name);
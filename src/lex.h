@@ -22,20 +22,34 @@ typedef enum TokType {
     TOK_COUNT
 } TokType;
 
+// literal values are decoded once while lexing. strings have their escapes
+// decoded into the lex pool
+typedef union TokLit {
+    uint64_t integer;
+    double floating;
+    bool boolean;
+    const View *string;
+    unsigned lexeme; // id from the Lang, 0 for escaped lexemes
+} TokLit;
+
 typedef struct TokBuf {
     void *zig_tbuf;
 
     TokType *types;
     hsize_t *starts, *lens;
+    TokLit *lits; // only set for lexeme, bool, int, float and string tokens
     size_t len;
 } TokBuf;
 
-// TODO direly needs an allocator context to avoid `malloc` calls
-TokBuf TokBuf_new(void);
-void TokBuf_del(TokBuf *);
+// large regions are split across at most this many threads, 0 means one per
+// cpu. 1 (the default) always lexes serially
+extern unsigned lex_max_threads;
 
-// adds tokens to tokbuf, returns success
-bool lex(TokBuf *, const File *, const Lang *, size_t start, size_t len);
+// token arrays are allocated in `pool` and live as long as it does. syntax
+// errors are reported and set global_error, and leave the TokBuf empty
+TokBuf lex(Bump *pool, const File *, const Lang *, size_t start, size_t len);
+// frees lexer bookkeeping outside of the pool
+void TokBuf_del(TokBuf *);
 
 void TokBuf_dump(TokBuf *, const File *);
 
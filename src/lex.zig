@@ -15,6 +15,11 @@ const c = @cImport({
 });
 
 const hsize_t = c.hsize_t;
+const TokLit = c.TokLit;
+
+// keyword values are a TokType with a lexeme id above it
+const id_shift = @intCast(u5, c.KEYWORD_ID_SHIFT);
+const type_mask = (@as(c_uint, 1) << id_shift) - 1;
 
 const TokType = enum(c_int) {
     Invalid = c.TOK_INVALID,
@@ -28,101 +33,347 @@ const TokType = enum(c_int) {
     Scope   = c.TOK_SCOPE
 };
 
-// TODO once I can remove CTokBuf, pretty sure I can replace this entirely
-// with a MultiArrayList
+fn cBumpCreate(comptime T: type, pool: *c.Bump) *T {
+    const mem = c.Bump_alloc_aligned(pool, @sizeOf(T), @alignOf(T));
+
+    return @ptrCast(*T, @alignCast(@alignOf(T), mem));
+}
+
+fn cBumpAlloc(comptime T: type, pool: *c.Bump, n: usize) []T {
+    const mem = c.Bump_alloc_aligned(pool, n * @sizeOf(T), @alignOf(T));
+
+    return @ptrCast([*]T, @alignCast(@alignOf(T), mem))[0..n];
+}
+
+/// index after the closing quote of the string opened at `open`, skipping
+/// backslash escapes. unterminated strings run to the end of `str`.
+fn stringEnd(str: []const u8, open: usize) usize {
+    var i = open + 1;
+    while (i < str.len) : (i += 1) {
+        switch (str[i]) {
+            '"' => return i + 1,
+            '\\' => i += 1,
+            else => {}
+        }
+    }
+
+    return str.len;
+}
+
+/// positions at least `every` bytes apart where a region can be split into
+/// segments that lex the same as the whole region
+const Splits = struct {
+    every: usize,
+    points: std.ArrayList(usize),
+
+    fn init(every: usize) Splits {
+        return Splits{
+            .every = every,
+            .points = std.ArrayList(usize).init(c_allocator),
+        };
+    }
+
+    fn deinit(self: *Splits) void {
+        self.points.deinit();
+    }
+};
+
+/// token arrays live in a caller-supplied pool and are handed to C as is. a
+/// buffer lexed into directly is sized up front from the length of the source,
+/// so emitting rarely has to grow it. a region lexed in parallel is sized once
+/// from its segments' token counts after they join.
 const TokBuf = struct {
     const allocator = c_allocator;
 
-    tokens: std.MultiArrayList(struct {
-        toktype: TokType,
-        start: hsize_t,
-        len: hsize_t,
-    }),
+    /// typical fungus code averages between 4 and 5 source bytes per token
+    /// (bench/lex measures 4.4), so this initial capacity is usually enough
+    /// without leaving much of it unused
+    const bytes_per_token = 4;
+    const min_capacity = 16;
+
+    pool: *c.Bump,
+    types: []TokType,
+    starts: []hsize_t,
+    lens: []hsize_t,
+    lits: []TokLit,
+    len: usize,
+    // end of the lexed region, for sizing growth
+    src_end: usize,
+
+    // every `{` in the lexed region paired with its `}`, ordered by `open`
+    scopes: std.ArrayListUnmanaged(ScopePair),
+
+    const ScopePair = struct {
+        open: hsize_t,
+        close: ?hsize_t,
+    };
 
     const CTokBuf = extern struct {
         tbuf: *TokBuf,
         types: [*]TokType,
         starts: [*]hsize_t,
         lens: [*]hsize_t,
+        lits: [*]TokLit,
         len: usize
     };
 
     const Self = @This();
 
     fn asCTokBuf(self: *Self) CTokBuf {
-        const slice = self.tokens.slice();
-
         return CTokBuf{
             .tbuf = self,
-            .types = slice.items(.toktype).ptr,
-            .starts = slice.items(.start).ptr,
-            .lens = slice.items(.len).ptr,
-            .len = self.tokens.len,
+            .types = self.types.ptr,
+            .starts = self.starts.ptr,
+            .lens = self.lens.ptr,
+            .lits = self.lits.ptr,
+            .len = self.len,
         };
     }
 
-    pub fn init(self: *Self) void {
-        self.tokens = @TypeOf(self.tokens){};
+    /// token arrays start out empty, see reserveFor
+    pub fn init(
+        self: *Self, pool: *c.Bump, src_start: usize, src_len: usize
+    ) void {
+        self.* = Self{
+            .pool = pool,
+            .types = cBumpAlloc(TokType, pool, 0),
+            .starts = cBumpAlloc(hsize_t, pool, 0),
+            .lens = cBumpAlloc(hsize_t, pool, 0),
+            .lits = cBumpAlloc(TokLit, pool, 0),
+            .len = 0,
+            .src_end = src_start + src_len,
+            .scopes = @TypeOf(self.scopes){},
+        };
     }
 
+    /// token arrays are freed with their pool
     pub fn deinit(self: *Self) void {
-        self.tokens.deinit(Self.allocator);
+        self.scopes.deinit(Self.allocator);
+    }
+
+    /// moves to bigger arrays if `cap` doesn't fit
+    fn reserve(self: *Self, cap: usize) void {
+        if (cap <= self.types.len)
+            return;
+
+        const types = cBumpAlloc(TokType, self.pool, cap);
+        const starts = cBumpAlloc(hsize_t, self.pool, cap);
+        const lens = cBumpAlloc(hsize_t, self.pool, cap);
+        const lits = cBumpAlloc(TokLit, self.pool, cap);
+
+        std.mem.copy(TokType, types, self.types[0..self.len]);
+        std.mem.copy(hsize_t, starts, self.starts[0..self.len]);
+        std.mem.copy(hsize_t, lens, self.lens[0..self.len]);
+        std.mem.copy(TokLit, lits, self.lits[0..self.len]);
+
+        self.types = types;
+        self.starts = starts;
+        self.lens = lens;
+        self.lits = lits;
+    }
+
+    /// reserves the estimated token count of `src_len` bytes of source, before
+    /// tokenizing into this buffer
+    fn reserveFor(self: *Self, src_len: usize) void {
+        self.reserve(std.math.max(src_len / bytes_per_token, min_capacity));
+    }
+
+    /// capacity for the rest of the region when the estimate was too low,
+    /// extrapolated from the bytes per token lexed so far plus some slack
+    fn grownCapacity(self: *const Self, pos: usize) usize {
+        if (self.len == 0)
+            return min_capacity;
+
+        const first = @as(usize, self.starts[0]);
+        const lexed = std.math.max(pos, first + 1) - first;
+        const rest = if (self.src_end > pos) self.src_end - pos else 0;
+        const more = self.len * rest / lexed;
+
+        return self.len + std.math.max(more + more / 8, min_capacity);
+    }
+
+    /// appends all tokens from another TokBuf
+    fn append(self: *Self, other: *const Self) void {
+        const len = self.len + other.len;
+
+        self.reserve(len);
+
+        std.mem.copy(TokType, self.types[self.len..len],
+                     other.types[0..other.len]);
+        std.mem.copy(hsize_t, self.starts[self.len..len],
+                     other.starts[0..other.len]);
+        std.mem.copy(hsize_t, self.lens[self.len..len],
+                     other.lens[0..other.len]);
+        std.mem.copy(TokLit, self.lits[self.len..len],
+                     other.lits[0..other.len]);
+
+        // decoded strings live in the other buffer's pool
+        if (other.pool != self.pool) {
+            var i = self.len;
+            while (i < len) : (i += 1) {
+                if (self.types[i] == .String) {
+                    self.lits[i].string =
+                        copyView(self.pool, self.lits[i].string.*);
+                }
+            }
+        }
+
+        self.len = len;
+    }
+
+    /// one linear pass pairing brackets in `str[start..]`. braces within
+    /// string literals are skipped. if `splits` is given, this also finds
+    /// places to split the region for parallel lexing.
+    pub fn matchScopes(
+        self: *Self, str: []const u8, start: usize, splits: ?*Splits
+    ) !void {
+        var open_stack = std.ArrayList(usize).init(Self.allocator);
+        defer open_stack.deinit();
+
+        var splitting = splits;
+        var last_split = start;
+        var last_solid: u8 = 0; // last char that isn't whitespace
+
+        var i: usize = start;
+        while (i < str.len) : (i += 1) {
+            switch (str[i]) {
+                // serial lexing stops at a nul, so segments can't go past it
+                0 => splitting = null,
+                '{' => {
+                    try open_stack.append(self.scopes.items.len);
+                    try self.scopes.append(Self.allocator, .{
+                        .open = @intCast(hsize_t, i),
+                        .close = null
+                    });
+                },
+                '}' => if (open_stack.popOrNull()) |index| {
+                    self.scopes.items[index].close = @intCast(hsize_t, i);
+                },
+                '"' => i = stringEnd(str, i) - 1,
+                ' ', '\t', '\n', '\r' => {
+                    // top level whitespace is always skipped between tokens,
+                    // unless it follows an escape
+                    if (splitting) |sp| {
+                        if (open_stack.items.len == 0 and last_solid != '`'
+                            and i - last_split >= sp.every) {
+                            try sp.points.append(i);
+                            last_split = i;
+                        }
+                    }
+
+                    continue;
+                },
+                else => {}
+            }
+
+            last_solid = str[i];
+        }
+    }
+
+    /// file offset of the `}` matching the `{` at `open`
+    pub fn scopeClose(self: *const Self, open: hsize_t) ?hsize_t {
+        const scopes = self.scopes.items;
+        var lo: usize = 0;
+        var hi: usize = scopes.len;
+
+        while (lo < hi) {
+            const mid = lo + (hi - lo) / 2;
+
+            if (scopes[mid].open < open) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+
+        if (lo == scopes.len or scopes[lo].open != open)
+            return null;
+
+        return scopes[lo].close;
     }
 
     pub fn emit(self: *Self, ty: TokType, start: hsize_t, len: hsize_t) !void {
-        try self.tokens.append(Self.allocator, .{
-            .toktype = ty,
-            .start = start,
-            .len = len
-        });
+        if (self.len == self.types.len)
+            self.reserve(self.grownCapacity(start));
+
+        self.types[self.len] = ty;
+        self.starts[self.len] = start;
+        self.lens[self.len] = len;
+        self.len += 1;
+    }
+
+    pub fn emitLit(
+        self: *Self, ty: TokType, start: hsize_t, len: hsize_t, lit: TokLit
+    ) !void {
+        try self.emit(ty, start, len);
+        self.lits[self.len - 1] = lit;
     }
 
     pub fn peek(self: *Self) ?TokType {
-        return if (self.tokens.len == 0)
+        return if (self.len == 0)
             null
         else
-            self.tokens.get(self.tokens.len - 1).toktype;
+            self.types[self.len - 1];
     }
 
     pub fn dump(self: *Self, file: *c.File) void {
         _ = c.printf(c.TC_CYAN ++ "Self:" ++ c.TC_RESET ++ "\n");
 
         var i: usize = 0;
-        while (i < self.tokens.len) : (i += 1) {
-            const token = self.tokens.get(i);
+        while (i < self.len) : (i += 1) {
+            const toktype = self.types[i];
 
-            const color = switch (token.toktype) {
+            const color = switch (toktype) {
                 .Ident => c.TC_BLUE,
                 .Bool, .Int, .Float => c.TC_MAGENTA,
                 .String => c.TC_GREEN,
                 else => c.TC_WHITE
             };
-            const tag_name = @tagName(token.toktype);
+            const tag_name = @tagName(toktype);
 
             _ = c.printf("%.*s: '%s%.*s" ++ c.TC_RESET ++ "'\n",
                          @intCast(c_int, tag_name.len),
                          tag_name.ptr,
                          color,
-                         @intCast(c_int, token.len),
-                         &c.File_str(file)[token.start]);
+                         @intCast(c_int, self.lens[i]),
+                         &c.File_str(file)[self.starts[i]]);
         }
 
         _ = c.printf("\n");
     }
 };
 
+/// a syntax error. errors are recorded rather than reported where they are
+/// found, so that parallel segments can stop and report in file order.
+const LexError = struct {
+    start: hsize_t,
+    /// null displays only the start of the region
+    len: ?hsize_t,
+    msg: [*:0]const u8,
+
+    fn report(self: LexError, file: *c.File) void {
+        if (self.len) |len| {
+            c.File_error_at(file, self.start, len, self.msg);
+        } else {
+            c.File_error_from(file, self.start, self.msg);
+        }
+    }
+};
+
 /// syntax error display region of a file
 fn lexErrorAt(
-    file: *c.File, start: hsize_t, len: hsize_t, msg: []const u8
-) noreturn {
-    c.File_error_at(file, start, len, msg.ptr);
-    std.os.exit(255);
+    ctx: LexContext, start: hsize_t, len: hsize_t, msg: [*:0]const u8
+) error{Syntax} {
+    ctx.err.* = LexError{ .start = start, .len = len, .msg = msg };
+    return error.Syntax;
 }
 
 /// syntax error displaying start of a region of a file
-fn lexErrorFrom(file: *c.File, start: hsize_t, msg: []const u8) noreturn {
-    c.File_error_from(file, start, msg.ptr);
-    std.os.exit(255);
+fn lexErrorFrom(
+    ctx: LexContext, start: hsize_t, msg: [*:0]const u8
+) error{Syntax} {
+    ctx.err.* = LexError{ .start = start, .len = null, .msg = msg };
+    return error.Syntax;
 }
 
 fn splitSymbol(ctx: LexContext, start: hsize_t, len: hsize_t) !void {
@@ -132,73 +383,269 @@ fn splitSymbol(ctx: LexContext, start: hsize_t, len: hsize_t) !void {
             .str = &c.File_str(ctx.file)[start + i],
             .len = len - i,
         };
+        var lexeme: c_uint = undefined;
         const match_len =
             @intCast(hsize_t,
-                     c.HashSet_longest(c.Lang_syms(ctx.lang), &token_view));
+                     c.Trie_longest(c.Lang_sym_trie(ctx.lang), &token_view,
+                                    &lexeme));
 
         if (match_len == 0) {
-            lexErrorAt(ctx.file, start + i, len - i, "unknown symbol");
+            return lexErrorAt(ctx, start + i, len - i, "unknown symbol");
         }
 
-        try ctx.tbuf.emit(.Lexeme, start + i, match_len);
+        try ctx.tbuf.emitLit(.Lexeme, start + i, match_len, TokLit{
+            .lexeme = lexeme
+        });
         i += match_len;
     }
 }
 
-// words can be lexemes or identifiers, this checks and adds the correct one
+// words can be lexemes, bools, or identifiers, this checks and adds the correct
+// one
 fn addWord(ctx: LexContext, slice: []const u8, start: hsize_t) !void {
-    const token_cword = c.Word_new(slice.ptr, slice.len);
-    var word_type =
-        if (std.mem.eql(u8, slice, "true") or std.mem.eql(u8, slice, "false"))
-            TokType.Bool
-        else if (c.HashSet_has(c.Lang_words(ctx.lang), &token_cword))
-            TokType.Lexeme
-        else
-            TokType.Ident;
+    const token_view = c.View{ .str = slice.ptr, .len = slice.len };
+    const len = @intCast(hsize_t, slice.len);
+    var value: c_uint = undefined;
 
-    try ctx.tbuf.emit(word_type, start, @intCast(hsize_t, slice.len));
+    if (!c.PerfectMap_get_checked(c.Lang_keywords(ctx.lang), &token_view,
+                                  &value)) {
+        try ctx.tbuf.emit(.Ident, start, len);
+        return;
+    }
+
+    const word_type = @intToEnum(TokType, @intCast(c_int, value & type_mask));
+    const lit = if (word_type == .Bool)
+        TokLit{ .boolean = slice[0] == 't' }
+    else
+        TokLit{ .lexeme = value >> id_shift };
+
+    try ctx.tbuf.emitLit(word_type, start, len, lit);
 }
 
 const LexContext = struct {
     tbuf: *TokBuf,
     file: *c.File,
     lang: *c.Lang,
+    err: *?LexError,
 };
 
+// literal decoding ============================================================
+
+fn copyView(pool: *c.Bump, view: c.View) *const c.View {
+    const chars = cBumpAlloc(u8, pool, view.len);
+    std.mem.copy(u8, chars, view.str[0..view.len]);
+
+    var copy = cBumpCreate(c.View, pool);
+    copy.* = c.View{ .str = chars.ptr, .len = view.len };
+
+    return copy;
+}
+
+/// number literals may separate digits with `_`, which has to sit between two
+/// digits. returns the index of the first `_` that doesn't.
+fn misplacedSeparator(slice: []const u8) ?usize {
+    for (slice) |ch, i| {
+        if (ch != '_')
+            continue;
+
+        const between = i > 0 and i + 1 < slice.len
+            and std.ascii.isDigit(slice[i - 1])
+            and std.ascii.isDigit(slice[i + 1]);
+
+        if (!between)
+            return i;
+    }
+
+    return null;
+}
+
+fn checkSeparators(ctx: LexContext, start: hsize_t, slice: []const u8) !void {
+    if (misplacedSeparator(slice)) |i| {
+        return lexErrorAt(ctx, start + @intCast(hsize_t, i), 1,
+                          "misplaced separator in number literal.");
+    }
+}
+
+/// value of decimal digits with `_` separators, null if it doesn't fit
+fn parseIntLit(slice: []const u8) ?u64 {
+    var value: u64 = 0;
+
+    for (slice) |ch| {
+        if (ch == '_')
+            continue;
+
+        value = std.math.mul(u64, value, 10) catch return null;
+        value = std.math.add(u64, value, ch - '0') catch return null;
+    }
+
+    return value;
+}
+
+/// value of digits with `_` separators around a `.`, which may be the last char
+fn parseFloatLit(slice: []const u8) !f64 {
+    var fallback = std.heap.stackFallback(64, c_allocator);
+    var digits =
+        try std.ArrayList(u8).initCapacity(fallback.get(), slice.len + 1);
+    defer digits.deinit();
+
+    // parseFloat doesn't accept separators or a trailing `.`
+    for (slice) |ch| {
+        if (ch != '_')
+            digits.appendAssumeCapacity(ch);
+    }
+
+    if (slice[slice.len - 1] == '.')
+        digits.appendAssumeCapacity('0');
+
+    return std.fmt.parseFloat(f64, digits.items);
+}
+
+/// decodes the escapes of a string literal's body, up to its closing quote,
+/// into `out`. `out` must be at least as long as `body`. returns the decoded
+/// length. this is the inverse of escapeCStr.
+fn decodeEscapes(body: []const u8, out: []u8) usize {
+    var n: usize = 0;
+
+    var i: usize = 0;
+    while (i < body.len and body[i] != '"') : (i += 1) {
+        var ch = body[i];
+
+        if (ch == '\\' and i + 1 < body.len) {
+            i += 1;
+            ch = switch (body[i]) {
+                '0' => 0,
+                'n' => '\n',
+                'r' => '\r',
+                't' => '\t',
+                '\\', '\'', '"' => body[i],
+                // other escapes are left as they are written
+                else => blk: {
+                    out[n] = '\\';
+                    n += 1;
+                    break :blk body[i];
+                },
+            };
+        }
+
+        out[n] = ch;
+        n += 1;
+    }
+
+    return n;
+}
+
+fn decodeInt(ctx: LexContext, start: hsize_t, len: hsize_t) !TokLit {
+    const slice = c.File_str(ctx.file)[start..start + len];
+
+    try checkSeparators(ctx, start, slice);
+
+    const value = parseIntLit(slice) orelse
+        return lexErrorAt(ctx, start, len, "integer literal is too large.");
+
+    return TokLit{ .integer = value };
+}
+
+fn decodeFloat(ctx: LexContext, start: hsize_t, len: hsize_t) !TokLit {
+    const slice = c.File_str(ctx.file)[start..start + len];
+
+    try checkSeparators(ctx, start, slice);
+
+    const value = parseFloatLit(slice) catch |e| switch (e) {
+        error.OutOfMemory => return e,
+        else => return lexErrorAt(ctx, start, len, "invalid float literal."),
+    };
+
+    return TokLit{ .floating = value };
+}
+
+/// decodes the string token at `start` into the token pool
+fn decodeString(ctx: LexContext, start: hsize_t, len: hsize_t) !TokLit {
+    const pool = ctx.tbuf.pool;
+    // unterminated strings have no closing quote
+    const body = c.File_str(ctx.file)[start + 1..start + len];
+    var chars = cBumpAlloc(u8, pool, body.len);
+    const n = decodeEscapes(body, chars);
+
+    var view = cBumpCreate(c.View, pool);
+    view.* = c.View{ .str = chars.ptr, .len = n };
+
+    return TokLit{ .string = view };
+}
+
+// run scanning ================================================================
+
+// tokens are mostly runs of a single char class. only the char at a class
+// boundary goes through classifyChar, run chars are tested directly.
+//
+// TODO scan runs with @Vector chunks (class masks + @ctz) once `zig build
+// bench -Drelease-fast` shows it beating this scalar loop
+
+fn isSpace(ch: u8) bool {
+    return switch (ch) {
+        ' ', '\n', '\t', '\r' => true,
+        else => false
+    };
+}
+
+fn isDigitRun(ch: u8) bool {
+    return switch (ch) {
+        '0'...'9', '_' => true,
+        else => false
+    };
+}
+
+fn isWordChar(ch: u8) bool {
+    return switch (ch) {
+        'a'...'z', 'A'...'Z', '0'...'9', '_' => true,
+        else => false
+    };
+}
+
+/// matches classifyChar's .Symbol; control chars end the run so that
+/// tokenize can reject them
+fn isSymbol(ch: u8) bool {
+    return switch (ch) {
+        0x00...0x20, '`', '{', '"' => false,
+        else => !isWordChar(ch)
+    };
+}
+
+/// returns the index of the first char at or after `start` outside the class
+fn runEnd(
+    str: []const u8, start: usize, comptime inClass: fn (u8) bool
+) usize {
+    var i = start;
+    while (i < str.len and inClass(str[i])) : (i += 1) {}
+
+    return i;
+}
+
 // TODO specific and descriptive user-facing errors
 fn tokenize(ctx: LexContext, scope_start: usize, scope_len: usize) !void {
-    const str = c.File_str(ctx.file)[scope_start..scope_start + scope_len];
+    // positions are file offsets, the region only bounds the scan
+    const str = c.File_str(ctx.file)[0..scope_start + scope_len];
 
-    var i: hsize_t = 0;
+    var i = @intCast(hsize_t, scope_start);
     while (true) {
-        var class: CharClass = undefined;
-
         // skip whitespace
-        while (i < str.len) : (i += 1) {
-            class = classifyChar(str[i]);
+        i = @intCast(hsize_t, runEnd(str, i, isSpace));
 
-            if (class != .Space)
-                break;
-        } else {
+        if (i == str.len)
             break;
-        }
+
+        // classifyChar can't classify control chars
+        if (str[i] != 0 and str[i] < 0x20)
+            return lexErrorAt(ctx, i, 1, "invalid character.");
 
         // identify next token
-        switch (class) {
+        switch (classifyChar(str[i])) {
             .Eof => break,
             .Space => unreachable,
             .Alpha, .Underscore => {
                 // word
                 const start = i;
 
-                while (i < str.len) {
-                    class = classifyChar(str[i]);
-
-                    switch (class) {
-                        .Alpha, .Underscore, .Digit => i += 1,
-                        else => break
-                    }
-                }
+                i = @intCast(hsize_t, runEnd(str, i, isWordChar));
 
                 try addWord(ctx, str[start..i], start);
             },
@@ -206,17 +653,13 @@ fn tokenize(ctx: LexContext, scope_start: usize, scope_len: usize) !void {
                 // symbols
                 const start = i;
 
-                while (i < str.len) : (i += 1) {
-                    class = classifyChar(str[i]);
-
-                    if (class != .Symbol)
-                        break;
-                }
+                i = @intCast(hsize_t, runEnd(str, i, isSymbol));
 
                 // check for literal lexeme
                 if (ctx.tbuf.peek()) |last| {
                     if (last == .Escape) {
-                        try ctx.tbuf.emit(.Lexeme, start, i - start);
+                        try ctx.tbuf.emitLit(.Lexeme, start, i - start,
+                                             TokLit{ .lexeme = 0 });
                         break :blk;
                     }
                 }
@@ -229,26 +672,20 @@ fn tokenize(ctx: LexContext, scope_start: usize, scope_len: usize) !void {
                 const start = i;
                 var tok_type: TokType = .Int;
 
-                while (i < str.len) : (i += 1) {
-                    class = classifyChar(str[i]);
+                i = @intCast(hsize_t, runEnd(str, i, isDigitRun));
 
-                    if (class != .Digit and class != .Underscore)
-                        break;
-                }
-
-                if (class == .Symbol and str[i] == '.') {
+                if (i < str.len and str[i] == '.') {
                     tok_type = .Float;
-                    i += 1;
-
-                    while (true) : (i += 1) {
-                        class = classifyChar(str[i]);
-
-                        if (class != .Digit and class != .Underscore)
-                            break;
-                    }
+                    i = @intCast(hsize_t, runEnd(str, i + 1, isDigitRun));
                 }
 
-                try ctx.tbuf.emit(tok_type, start, i - start);
+                const len = i - start;
+                const lit = if (tok_type == .Int)
+                    try decodeInt(ctx, start, len)
+                else
+                    try decodeFloat(ctx, start, len);
+
+                try ctx.tbuf.emitLit(tok_type, start, len, lit);
             },
             .Escape => {
                 try ctx.tbuf.emit(.Escape, i, 1);
@@ -258,34 +695,20 @@ fn tokenize(ctx: LexContext, scope_start: usize, scope_len: usize) !void {
                 // strings
                 const start = i;
 
-                while (i < str.len - 1) {
-                    i += 1;
+                i = @intCast(hsize_t, stringEnd(str, i));
 
-                    if (str[i] == '"' and str[i - 1] != '\\')
-                        break;
-                }
+                const len = i - start;
+                const lit = try decodeString(ctx, start, len);
 
-                try ctx.tbuf.emit(.String, start, i - start);
+                try ctx.tbuf.emitLit(.String, start, len, lit);
             },
             .LCurly => {
                 // scopes
                 const start = i;
+                const close = ctx.tbuf.scopeClose(start) orelse
+                    return lexErrorFrom(ctx, start, "unmatched curly.");
 
-                var level: i32 = 0;
-                while (i < str.len) : (i += 1) {
-                    switch (str[i]) {
-                        '{' => level += 1,
-                        '}' => level -= 1,
-                        else => {}
-                    }
-
-                    if (level == 0) {
-                        i += 1;
-                        break;
-                    }
-                } else {
-                    lexErrorFrom(ctx.file, start, "unmatched curly.");
-                }
+                i = close + 1;
 
                 try ctx.tbuf.emit(.Scope, start, i - start);
             }
@@ -293,37 +716,395 @@ fn tokenize(ctx: LexContext, scope_start: usize, scope_len: usize) !void {
     }
 }
 
-// c interface =================================================================
+// parallel lexing =============================================================
 
-export fn TokBuf_new() TokBuf.CTokBuf {
-    var tbuf: TokBuf = undefined;
-    tbuf.init();
+/// regions at least this long are lexed in parallel
+const parallel_min_len = 1 << 20;
+/// but not split into segments shorter than this
+const segment_min_len = 256 << 10;
+/// segments per worker thread, so a slow segment doesn't hold up the rest
+const segments_per_thread = 4;
 
-    return tbuf.asCTokBuf();
+/// most threads a region is lexed on, 0 for one per cpu. serial until the
+/// parallel path has been measured against it
+export var lex_max_threads: c_uint = 1;
+
+fn workerCount() usize {
+    const cpus = std.Thread.getCpuCount() catch 1;
+
+    if (lex_max_threads == 0)
+        return cpus;
+
+    return std.math.min(cpus, @as(usize, lex_max_threads));
 }
 
+const Segment = struct {
+    ctx: LexContext,
+    pool: c.Bump,
+    tbuf: TokBuf,
+    err: ?LexError,
+    result: anyerror!void,
+    start: usize,
+    len: usize,
+};
+
+/// segments are handed out to workers in file order
+const SegmentQueue = struct {
+    segments: []Segment,
+    next: usize = 0,
+    failed: bool = false,
+};
+
+/// takes segments from the queue until it is empty or a segment fails. since
+/// segments are taken in order, every segment before a failing one has been
+/// taken, so the first failure in file order is among those that ran.
+fn lexSegments(queue: *SegmentQueue) void {
+    while (!@atomicLoad(bool, &queue.failed, .SeqCst)) {
+        const i = @atomicRmw(usize, &queue.next, .Add, 1, .SeqCst);
+        if (i >= queue.segments.len)
+            return;
+
+        const seg = &queue.segments[i];
+        seg.result = tokenize(seg.ctx, seg.start, seg.len);
+
+        if (seg.result) |_| {} else |_| {
+            @atomicStore(bool, &queue.failed, true, .SeqCst);
+        }
+    }
+}
+
+/// lexes the segments between `splits` on a pool of at most `workers` threads
+/// into their own TokBufs, then concatenates them in order. token positions
+/// are file offsets, so segments concatenate without any rebasing.
+fn lexParallel(
+    ctx: LexContext, start: usize, len: usize, splits: []const usize,
+    workers: usize
+) !void {
+    const allocator = c_allocator;
+    const num_segments = splits.len + 1;
+
+    var segments = try allocator.alloc(Segment, num_segments);
+    defer allocator.free(segments);
+
+    for (segments) |*seg, i| {
+        const seg_start = if (i == 0) start else splits[i - 1];
+        const seg_end = if (i == splits.len) start + len else splits[i];
+
+        seg.pool = c.Bump_new();
+        seg.tbuf.init(&seg.pool, seg_start, seg_end - seg_start);
+        seg.tbuf.reserveFor(seg_end - seg_start);
+        // segments share the region's scope table, read only
+        seg.tbuf.scopes = ctx.tbuf.scopes;
+        seg.err = null;
+        seg.result = {};
+        seg.ctx = LexContext{
+            .tbuf = &seg.tbuf,
+            .file = ctx.file,
+            .lang = ctx.lang,
+            .err = &seg.err,
+        };
+        seg.start = seg_start;
+        seg.len = seg_end - seg_start;
+    }
+
+    defer {
+        for (segments) |*seg| {
+            c.Bump_del(&seg.pool);
+        }
+    }
+
+    // this thread is one of the workers
+    const num_threads = std.math.min(workers, num_segments) - 1;
+
+    var threads = try allocator.alloc(std.Thread, num_threads);
+    defer allocator.free(threads);
+
+    var queue = SegmentQueue{ .segments = segments };
+    var spawned: usize = 0;
+
+    // if spawning fails, the threads that did start take up the work
+    while (spawned < num_threads) : (spawned += 1) {
+        threads[spawned] =
+            std.Thread.spawn(.{}, lexSegments, .{&queue}) catch break;
+    }
+
+    lexSegments(&queue);
+
+    for (threads[0..spawned]) |thread| {
+        thread.join();
+    }
+
+    for (segments) |*seg| {
+        seg.result catch |e| {
+            if (seg.err) |err|
+                ctx.err.* = err;
+
+            return e;
+        };
+    }
+
+    // the region's buffer is only sized now, so the tokens aren't reserved
+    // twice
+    var total: usize = ctx.tbuf.len;
+    for (segments) |seg| {
+        total += seg.tbuf.len;
+    }
+
+    ctx.tbuf.reserve(total);
+
+    for (segments) |*seg| {
+        ctx.tbuf.append(&seg.tbuf);
+    }
+}
+
+/// lexes `len` bytes from `start` into `ctx.tbuf`
+fn lexRegion(ctx: LexContext, start: usize, len: usize) !void {
+    const str = c.File_str(ctx.file)[0..start + len];
+
+    // split large regions into a few segments per worker
+    const workers = workerCount();
+    var num_segments: usize = 1;
+    if (len >= parallel_min_len and workers > 1) {
+        num_segments = std.math.min(workers * segments_per_thread,
+                                    len / segment_min_len);
+    }
+
+    if (num_segments > 1) {
+        var splits = Splits.init(len / num_segments);
+        defer splits.deinit();
+
+        try ctx.tbuf.matchScopes(str, start, &splits);
+        try lexParallel(ctx, start, len, splits.points.items, workers);
+    } else {
+        try ctx.tbuf.matchScopes(str, start, null);
+        ctx.tbuf.reserveFor(len);
+        try tokenize(ctx, start, len);
+    }
+}
+
+// c interface =================================================================
+
 export fn TokBuf_del(ctbuf: *TokBuf.CTokBuf) void {
     ctbuf.tbuf.deinit();
-    c_allocator.destroy(ctbuf.tbuf);
 }
 
 export fn lex(
-    file: *c.File, lang: *c.Lang, start: usize, len: usize
+    pool: *c.Bump, file: *c.File, lang: *c.Lang, start: usize, len: usize
 ) TokBuf.CTokBuf {
-    var tbuf = utils.must(c_allocator.create(TokBuf));
-    tbuf.init();
+    var tbuf = cBumpCreate(TokBuf, pool);
+    tbuf.init(pool, start, len);
 
+    var err: ?LexError = null;
     const ctx = LexContext{
         .tbuf = tbuf,
         .file = file,
-        .lang = lang
+        .lang = lang,
+        .err = &err,
     };
 
-    utils.must(tokenize(ctx, start, len));
+    // errors are reported and passed on through global_error, with no tokens
+    lexRegion(ctx, start, len) catch |e| switch (e) {
+        error.Syntax => {
+            err.?.report(file);
+            c.global_error = true;
+            tbuf.len = 0;
+        },
+        else => utils.reportErrorAndPanic(e),
+    };
 
     return tbuf.asCTokBuf();
 }
 
 export fn TokBuf_dump(ctbuf: *TokBuf.CTokBuf, file: *c.File) void {
     ctbuf.tbuf.dump(file);
-}
\ No newline at end of file
+}
+
+// tests =======================================================================
+
+const testing = std.testing;
+
+test "TokBuf reserves from the source length and grows past it" {
+    var pool = c.Bump_new();
+    defer c.Bump_del(&pool);
+
+    var tbuf: TokBuf = undefined;
+    tbuf.init(&pool, 0, 400);
+    defer tbuf.deinit();
+
+    tbuf.reserveFor(400);
+    try testing.expectEqual(@as(usize, 400 / TokBuf.bytes_per_token),
+                            tbuf.types.len);
+
+    // twice the estimate, so emit has to grow the arrays
+    var i: hsize_t = 0;
+    while (i < 200) : (i += 1) {
+        try tbuf.emitLit(.Int, i * 2, 1, TokLit{ .integer = i });
+    }
+
+    try testing.expectEqual(@as(usize, 200), tbuf.len);
+    try testing.expect(tbuf.types.len >= 200);
+
+    i = 0;
+    while (i < 200) : (i += 1) {
+        try testing.expectEqual(TokType.Int, tbuf.types[i]);
+        try testing.expectEqual(i * 2, tbuf.starts[i]);
+        try testing.expectEqual(@as(hsize_t, 1), tbuf.lens[i]);
+        try testing.expectEqual(@as(u64, i), tbuf.lits[i].integer);
+    }
+}
+
+test "TokBuf grows without a reservation" {
+    var pool = c.Bump_new();
+    defer c.Bump_del(&pool);
+
+    var tbuf: TokBuf = undefined;
+    tbuf.init(&pool, 10, 100);
+    defer tbuf.deinit();
+
+    try tbuf.emit(.Ident, 10, 3);
+    try tbuf.emit(.Escape, 14, 1);
+
+    try testing.expectEqual(@as(usize, 2), tbuf.len);
+    try testing.expectEqual(TokType.Escape, tbuf.peek().?);
+}
+
+test "TokBuf.append moves strings into its own pool" {
+    var pool = c.Bump_new();
+    defer c.Bump_del(&pool);
+    var seg_pool = c.Bump_new();
+
+    var tbuf: TokBuf = undefined;
+    tbuf.init(&pool, 0, 8);
+    defer tbuf.deinit();
+    var seg: TokBuf = undefined;
+    seg.init(&seg_pool, 8, 8);
+    defer seg.deinit();
+
+    const chars = cBumpAlloc(u8, &seg_pool, 2);
+    std.mem.copy(u8, chars, "hi");
+
+    var view = cBumpCreate(c.View, &seg_pool);
+    view.* = c.View{ .str = chars.ptr, .len = chars.len };
+
+    try tbuf.emit(.Ident, 0, 1);
+    try seg.emitLit(.String, 8, 4, TokLit{ .string = view });
+
+    tbuf.append(&seg);
+    c.Bump_del(&seg_pool);
+
+    try testing.expectEqual(@as(usize, 2), tbuf.len);
+    try testing.expectEqual(TokType.String, tbuf.types[1]);
+    try testing.expectEqual(@as(hsize_t, 8), tbuf.starts[1]);
+
+    const str = tbuf.lits[1].string.*;
+    try testing.expectEqualStrings("hi", str.str[0..str.len]);
+}
+
+test "number separators sit between two digits" {
+    const none: ?usize = null;
+
+    try testing.expectEqual(none, misplacedSeparator("1_000"));
+    try testing.expectEqual(none, misplacedSeparator("1_2.3_4"));
+    try testing.expectEqual(none, misplacedSeparator("12."));
+
+    try testing.expectEqual(@as(?usize, 1), misplacedSeparator("1_"));
+    try testing.expectEqual(@as(?usize, 1), misplacedSeparator("1__0"));
+    try testing.expectEqual(@as(?usize, 1), misplacedSeparator("1_.5"));
+    try testing.expectEqual(@as(?usize, 2), misplacedSeparator("1._5"));
+    try testing.expectEqual(@as(?usize, 3), misplacedSeparator("1.5_"));
+}
+
+test "int literals" {
+    try testing.expectEqual(@as(?u64, 0), parseIntLit("0"));
+    try testing.expectEqual(@as(?u64, 1000), parseIntLit("1_000"));
+    try testing.expectEqual(@as(?u64, std.math.maxInt(u64)),
+                            parseIntLit("18446744073709551615"));
+    try testing.expectEqual(@as(?u64, null),
+                            parseIntLit("18446744073709551616"));
+}
+
+test "float literals" {
+    try testing.expectEqual(@as(f64, 1.0), try parseFloatLit("1."));
+    try testing.expectEqual(@as(f64, 1.5), try parseFloatLit("1.5"));
+    try testing.expectEqual(@as(f64, 0.125), try parseFloatLit("0.125"));
+    try testing.expectEqual(@as(f64, 1000.25), try parseFloatLit("1_000.2_5"));
+    // longer than the stack buffer
+    try testing.expectEqual(@as(f64, 1e80),
+                            try parseFloatLit("1" ++ "0" ** 80 ++ "."));
+}
+
+fn expectDecoded(expected: []const u8, body: []const u8) !void {
+    var out: [64]u8 = undefined;
+    const n = decodeEscapes(body, &out);
+
+    try testing.expectEqualStrings(expected, out[0..n]);
+}
+
+test "string escapes" {
+    try expectDecoded("plain", "plain\"");
+    try expectDecoded("a\nb\tc\rd\x00e", "a\\nb\\tc\\rd\\0e\"");
+    try expectDecoded("\\ ' \"", "\\\\ \\' \\\"\"");
+    // unknown escapes are kept as written
+    try expectDecoded("\\q", "\\q\"");
+    // unterminated strings run to the end of the body
+    try expectDecoded("open", "open");
+    try expectDecoded("trailing\\", "trailing\\");
+    // nothing after the closing quote is decoded
+    try expectDecoded("a", "a\" b");
+}
+
+test "string escapes invert escapeCStr" {
+    const str = "tab\there\nquote\" slash\\ nul\x00 end";
+    var escaped = try lex_strings.escapeCStr(str, str.len);
+    defer escaped.deinit();
+
+    // closing quote
+    try escaped.append('"');
+
+    try expectDecoded(str, escaped.items);
+}
+
+test "words lex as lexemes, bools and idents" {
+    c.words_init();
+    defer c.words_quit();
+
+    var lang = c.Lang_new(c.Word_new("Test", 4));
+    defer c.Lang_del(&lang);
+
+    const let = c.Word_new("let", 3);
+    const plus = c.Word_new("+", 1);
+
+    c.HashSet_put(&lang.words, &let);
+    c.HashSet_put(&lang.syms, &plus);
+    c.Lang_immediate_crystallize(&lang);
+
+    const let_id = c.Lang_lexeme_id(&lang, &let);
+    const plus_id = c.Lang_lexeme_id(&lang, &plus);
+
+    const text = "let x true false let_1 + `+";
+    var file = c.File_from_str("test", text, text.len);
+    defer c.File_del(&file);
+
+    var pool = c.Bump_new();
+    defer c.Bump_del(&pool);
+
+    var toks = lex(&pool, &file, &lang, 0, text.len);
+    defer TokBuf_del(&toks);
+
+    const types = [_]TokType{
+        .Lexeme, .Ident, .Bool, .Bool, .Ident, .Lexeme, .Escape, .Lexeme
+    };
+
+    try testing.expectEqual(@as(usize, types.len), toks.len);
+
+    for (types) |ty, i| {
+        try testing.expectEqual(ty, toks.types[i]);
+    }
+
+    try testing.expectEqual(let_id, toks.lits[0].lexeme);
+    try testing.expect(toks.lits[2].boolean);
+    try testing.expect(!toks.lits[3].boolean);
+    try testing.expectEqual(plus_id, toks.lits[5].lexeme);
+    // escaped symbols are literal, with no id
+    try testing.expectEqual(@as(c_uint, 0), toks.lits[7].lexeme);
+}
@@ -10,14 +10,12 @@
 // returns success
 bool try_compile_file(File *file, Names *names) {
     // lex
-    TokBuf tokbuf = TokBuf_new();
-
-    lex(&tokbuf, file, &fungus_lang, 0, file->text.len);
+    Bump parse_pool = Bump_new();
+    TokBuf tokbuf = lex(&parse_pool, file, &fungus_lang, 0, file->text.len);
 
-    if (global_error) goto cleanup_lex;
+    if (global_error) goto cleanup_parse;
 
     // parse
-    Bump parse_pool = Bump_new();
     AstExpr *ast = parse(&(AstCtx){
         .pool = &parse_pool,
         .file = file,
@@ -58,9 +56,8 @@ bool try_compile_file(File *file, Names *names) {
 cleanup_fir:
     Bump_del(&fir_pool);
 cleanup_parse:
-    Bump_del(&parse_pool);
-cleanup_lex:
     TokBuf_del(&tokbuf);
+    Bump_del(&parse_pool);
 
     bool success = !global_error;
     global_error = false;
@@ -88,7 +85,7 @@ bool test_file(char *filepath, Names *names) {
     printf(TC_GREEN "testing '%s':" TC_RESET "\n", filepath);
 
     puts("```");
-    printf("%s", file.text.str);
+    printf("%.*s", (int)file.text.len, file.text.str);
     puts("\n```");
 
     if (!try_compile_file(&file, names))
@@ -102,6 +99,7 @@ bool test_file(char *filepath, Names *names) {
 int main(int argc, char **argv) {
     puts(TC_YELLOW "fungus v0 - by garrisonhh" TC_RESET);
 
+    words_init();
     types_init();
     names_init();
     Names name_table = Names_new();
@@ -126,6 +124,7 @@ int main(int argc, char **argv) {
     Names_del(&name_table);
     names_quit();
     types_quit();
+    words_quit();
 
     return 0;
 }
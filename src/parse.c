@@ -1,4 +1,6 @@
 #include <assert.h>
+#include <limits.h>
+#include <string.h>
 
 #include "parse.h"
 #include "fungus.h"
@@ -7,7 +9,7 @@
 
 static AstExpr *new_atom(Bump *pool, Type type, Type evaltype,
                          hsize_t start, hsize_t len) {
-    AstExpr *expr = Bump_alloc(pool, sizeof(*expr));
+    AstExpr *expr = BUMP_NEW(pool, AstExpr);
 
     *expr = (AstExpr){
         .type = type,
@@ -21,7 +23,7 @@ static AstExpr *new_atom(Bump *pool, Type type, Type evaltype,
 
 static AstExpr *new_rule(Bump *pool, const RuleTree *rt, Rule rule,
                          AstExpr **exprs, size_t len) {
-    AstExpr *expr = Bump_alloc(pool, sizeof(*expr));
+    AstExpr *expr = BUMP_NEW(pool, AstExpr);
 
     *expr = (AstExpr){
         .type = Rule_typeof(rt, rule),
@@ -36,7 +38,7 @@ static AstExpr *new_rule(Bump *pool, const RuleTree *rt, Rule rule,
 
 static AstExpr *rule_copy_of_slice(Bump *pool, const RuleTree *rt, Rule rule,
                                    AstExpr **slice, size_t len) {
-    AstExpr **exprs = Bump_alloc(pool, len * sizeof(*exprs));
+    AstExpr **exprs = BUMP_ARRAY(pool, AstExpr *, len);
 
     for (size_t j = 0; j < len; ++j)
         exprs[j] = slice[j];
@@ -44,9 +46,14 @@ static AstExpr *rule_copy_of_slice(Bump *pool, const RuleTree *rt, Rule rule,
     return new_rule(pool, rt, rule, exprs, len);
 }
 
+// short inputs (like rule patterns) parse without touching the heap
+SMALLVEC(AstExprVec, AstExpr *, 64)
+
 // turns tokens -> scope of AstExprs
-static Vec gen_initial_scope(AstCtx *ctx, const TokBuf *tb) {
-    Vec scope = Vec_new();
+static AstExprVec gen_initial_scope(AstCtx *ctx, const TokBuf *tb) {
+    AstExprVec scope = AstExprVec_new();
+
+    AstExprVec_reserve(&scope, tb->len);
 
     for (size_t i = 0; i < tb->len; ++i) {
         TokType toktype = tb->types[i];
@@ -75,6 +82,7 @@ static Vec gen_initial_scope(AstCtx *ctx, const TokBuf *tb) {
             break;
         case TOK_LEXEME:
             expr = new_atom(ctx->pool, fun_lexeme, fun_lexeme, start, len);
+            expr->lit = tb->lits[i];
             break;
         case TOK_IDENT:
             expr = new_atom(ctx->pool, fun_ident, fun_unknown, start, len);
@@ -93,6 +101,7 @@ static Vec gen_initial_scope(AstCtx *ctx, const TokBuf *tb) {
             // literal; direct token -> expr translation
             expr = new_atom(ctx->pool, fun_literal, evaltype_of_lit[toktype],
                             start, len);
+            expr->lit = tb->lits[i];
             break;
         }
         case TOK_INVALID:
@@ -101,14 +110,14 @@ static Vec gen_initial_scope(AstCtx *ctx, const TokBuf *tb) {
         }
 
         assert(expr != NULL);
-        Vec_push(&scope, expr);
+        AstExprVec_push(&scope, expr);
     }
 
     DEBUG_SCOPE(0,
         puts(TC_YELLOW "TRANSLATED TOKENS:" TC_RESET);
 
         for (size_t i = 0; i < scope.len; ++i) {
-            const AstExpr *expr = scope.data[i];
+            const AstExpr *expr = AstExprVec_data(&scope)[i];
 
             Type_print(expr->type);
             printf("!");
@@ -121,22 +130,30 @@ static Vec gen_initial_scope(AstCtx *ctx, const TokBuf *tb) {
     return scope;
 }
 
-static size_t try_match_r(AstCtx *ctx, const Vec *nexts, AstExpr **slice,
-                          size_t len, size_t depth, Rule *o_rule) {
+// `io_reach` grows to cover the exprs looked at, the end of the slice included
+static size_t try_match_r(AstCtx *ctx, const RuleIndex *index,
+                          AstExpr **slice, size_t len, size_t depth,
+                          Rule *o_rule, size_t *io_reach) {
+    *io_reach = MAX(*io_reach, depth);
+
     if (len == 0)
         return 0;
 
     size_t best_depth = 0;
     Rule rule = {0};
 
-    for (size_t i = 0; i < nexts->len; ++i) {
-        const RuleNode *node = nexts->data[i];
+    RuleNode *const *nodes;
+    size_t num_nodes = RuleIndex_get(index, slice[0], &nodes);
 
-        if (MatchAtom_matches_rule(ctx->file, node->pred, slice[0])) {
+    for (size_t i = 0; i < num_nodes; ++i) {
+        const RuleNode *node = nodes[i];
+
+        if (MatchAtom_matches_rule(node->pred, slice[0])) {
             // match node children
             Rule child_rule;
-            size_t child_depth = try_match_r(ctx, &node->nexts, slice + 1,
-                                             len - 1, depth + 1, &child_rule);
+            size_t child_depth = try_match_r(ctx, &node->index, slice + 1,
+                                             len - 1, depth + 1, &child_rule,
+                                             io_reach);
 
             if (child_depth > best_depth) {
                 rule = child_rule;
@@ -156,10 +173,14 @@ static size_t try_match_r(AstCtx *ctx, const Vec *nexts, AstExpr **slice,
     return best_depth;
 }
 
-// tries to match a rule on a slice, returns length of rule matched
+// tries to match a rule on a slice, returns length of rule matched. the result
+// only depends on the first `o_reach` exprs (counting the end of the slice)
 static size_t try_match(AstCtx *ctx, AstExpr **slice, size_t len,
-                        Rule *o_rule) {
-    return try_match_r(ctx, &ctx->lang->rules.roots, slice, len, 1, o_rule);
+                        Rule *o_rule, size_t *o_reach) {
+    *o_reach = 0;
+
+    return try_match_r(ctx, &ctx->lang->rules.root_index, slice, len, 1,
+                       o_rule, o_reach);
 }
 
 static void debug_slice(AstCtx *ctx, AstExpr **slice, size_t len,
@@ -179,110 +200,988 @@ static void debug_slice(AstCtx *ctx, AstExpr **slice, size_t len,
 #endif
 }
 
-// parse a slice of unparsed exprs into a tree
-// TODO maybe I should allocate a second buffer and do a write/swap algo instead
-// of in-place modification to help cache performance? not super important
-// in the immediate future
-static AstExpr *parse_scope(AstCtx *ctx, AstExpr **orig_slice, size_t len) {
+// try_match result at a scope position, kept until a collapse lands within
+// the exprs it looked at
+typedef struct ScopeMatch {
+    Rule rule;
+    unsigned len;
+    unsigned reach; // 0 when stale
+
+    // position of the expr before anything collapsed, a collapsed expr takes
+    // its last child's. always increasing through the scope
+    unsigned origin;
+    bool queued; // for the next sweep
+} ScopeMatch;
+
+SMALLVEC(ScopeMatchVec, ScopeMatch, 64)
+SMALLVEC(PosVec, size_t, 64)
+
+/*
+ * the exprs of a scope being parsed and their matches sit in a gap buffer.
+ * exprs [0, gap) come before the gap and [gap_end, cap) after it. a collapse
+ * happens at the gap and only moves gap_end. the gap is only moved to where a
+ * collapse or try_match needs it, which a sweep reaches in order, so every
+ * sweep is linear.
+ */
+typedef struct Sweep {
+    AstCtx *ctx;
+    const RuleTree *rules;
+
+    AstExpr **exprs;
+    ScopeMatch *matches;
+    size_t cap, gap, gap_end;
+
+    // the furthest any match has looked, bounds how far back a collapse can
+    // make matches stale
+    size_t max_reach;
+} Sweep;
+
+/*
+ * origins of the key lexemes of the prec being swept, in order. a match of
+ * the prec starts at most `lead` exprs before one of them, so the sweep only
+ * visits those positions. `next` is the first key which may still have some
+ * ahead of (or for right sweeps, behind) the sweep
+ */
+typedef struct SweepKeys {
+    const size_t *origins;
+    size_t len, next;
+    size_t lead;
+} SweepKeys;
+
+static size_t Sweep_len(const Sweep *sw) {
+    return sw->gap + (sw->cap - sw->gap_end);
+}
+
+// index of position `pos` in the buffer
+static size_t Sweep_at(const Sweep *sw, size_t pos) {
+    return pos < sw->gap ? pos : pos + (sw->gap_end - sw->gap);
+}
+
+static size_t Sweep_origin(const Sweep *sw, size_t pos) {
+    return sw->matches[Sweep_at(sw, pos)].origin;
+}
+
+// position of the first expr with an origin of at least `origin`. gallops out
+// from `hint` before searching, so it's cheap when that's close
+static size_t Sweep_find(const Sweep *sw, size_t origin, size_t hint) {
+    size_t len = Sweep_len(sw);
+    size_t lo = MIN(hint, len), hi = lo; // the position is in [lo, hi]
+    size_t step = 1;
+
+    if (lo < len && Sweep_origin(sw, lo) < origin) {
+        do {
+            lo = hi + 1;
+            hi = MIN(hi + step, len);
+            step *= 2;
+        } while (hi < len && Sweep_origin(sw, hi) < origin);
+    } else {
+        while (lo > 0 && Sweep_origin(sw, lo - 1) >= origin) {
+            hi = lo - 1;
+            lo -= MIN(lo, step);
+            step *= 2;
+        }
+    }
+
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+
+        if (Sweep_origin(sw, mid) < origin)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    return lo;
+}
+
+// moves the gap to position `pos`
+static void Sweep_seek(Sweep *sw, size_t pos) {
+    if (sw->gap == sw->gap_end) {
+        sw->gap = sw->gap_end = pos;
+        return;
+    }
+
+    // one expr at a time, so nothing is overwritten before it moves
+    while (sw->gap < pos) {
+        sw->exprs[sw->gap] = sw->exprs[sw->gap_end];
+        sw->matches[sw->gap++] = sw->matches[sw->gap_end++];
+    }
+
+    while (sw->gap > pos) {
+        sw->exprs[--sw->gap_end] = sw->exprs[--sw->gap];
+        sw->matches[sw->gap_end] = sw->matches[sw->gap];
+    }
+}
+
+static const ScopeMatch *Sweep_match(Sweep *sw, size_t pos) {
+    ScopeMatch *m = &sw->matches[Sweep_at(sw, pos)];
+
+    if (!m->reach) {
+        size_t reach;
+
+        // try_match needs the exprs from `pos` on in one piece
+        Sweep_seek(sw, pos);
+        m = &sw->matches[sw->gap_end];
+
+        m->len = try_match(sw->ctx, &sw->exprs[sw->gap_end],
+                           sw->cap - sw->gap_end, &m->rule, &reach);
+        m->reach = reach;
+        m->queued = false;
+        sw->max_reach = MAX(sw->max_reach, reach);
+    }
+
+    return m;
+}
+
+static bool Sweep_collapses(Sweep *sw, const ScopeMatch *m, Prec prec) {
+    return m->len && Rule_get(sw->rules, m->rule)->prec.id == prec.id;
+}
+
+/*
+ * collapses `len` exprs at `pos` into a `rule` expr, which stales matches at
+ * and before `pos` that looked at them. those before `pos` are queued in
+ * `o_stale` in order, if it isn't NULL.
+ *
+ * positions less than `lead` before `pos` might now reach a key which moved
+ * back, so they're queued too if the sweep skipped them
+ */
+static void Sweep_collapse(Sweep *sw, size_t pos, Rule rule, size_t len,
+                           size_t lead, PosVec *o_stale) {
+    size_t diff = len - 1;
+
+    Sweep_seek(sw, pos);
+
+    sw->exprs[sw->gap_end + diff] =
+        rule_copy_of_slice(sw->ctx->pool, sw->rules, rule,
+                           &sw->exprs[sw->gap_end], len);
+    sw->gap_end += diff;
+    sw->matches[sw->gap_end].reach = 0;
+
+    if (!o_stale)
+        lead = 0;
+
+    // positions before the gap are where they are in the buffer
+    size_t start = o_stale ? o_stale->len : 0;
+    size_t back = MAX(sw->max_reach, lead);
+
+    for (size_t j = pos; j-- > 0 && pos - j < back; ) {
+        ScopeMatch *m = &sw->matches[j];
+
+        if (m->reach > pos - j)
+            m->reach = 0;
+        else if (m->reach || pos - j >= lead)
+            continue;
+
+        if (o_stale && !m->queued) {
+            m->queued = true;
+            PosVec_push(o_stale, j);
+        }
+    }
+
+    if (!o_stale)
+        return;
+
+    // found in reverse
+    size_t *stale = PosVec_data(o_stale);
+
+    for (size_t a = start, b = o_stale->len; a + 1 < b; ++a, --b) {
+        size_t tmp = stale[a];
+
+        stale[a] = stale[b - 1];
+        stale[b - 1] = tmp;
+    }
+}
+
+// first position from `pos` on within reach of a key, or the length
+static size_t SweepKeys_from(SweepKeys *keys, const Sweep *sw, size_t pos) {
+    for (; keys->next < keys->len; ++keys->next) {
+        size_t at = Sweep_find(sw, keys->origins[keys->next], pos);
+
+        if (at >= pos)
+            return MAX(pos, at - MIN(at, keys->lead));
+    }
+
+    return Sweep_len(sw);
+}
+
+// last position up to `pos` within reach of a key, and in `o_low` the first
+// position within reach of that key. false if there isn't one
+static bool SweepKeys_until(SweepKeys *keys, const Sweep *sw, size_t pos,
+                            size_t *o_pos, size_t *o_low) {
+    for (; keys->next > 0; --keys->next) {
+        size_t at = Sweep_find(sw, keys->origins[keys->next - 1], pos);
+        size_t low = at - MIN(at, keys->lead);
+
+        if (low <= pos) {
+            *o_pos = MIN(at, pos);
+            *o_low = low;
+
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/*
+ * sweeps `prec` left to right, collapsing matches as it goes. only matches
+ * behind the sweep can go stale, they are queued in `o_stale` for the next
+ * sweep to revisit. the sweep visits the positions queued by the last one if
+ * `todo` isn't NULL, or those within reach of `keys` if it isn't NULL, or
+ * else every position
+ */
+static void Sweep_left(Sweep *sw, Prec prec, const PosVec *todo,
+                       SweepKeys *keys, PosVec *o_stale) {
+    const size_t *todo_pos = todo ? PosVec_data(todo) : NULL;
+    size_t next = 0, shift = 0; // todo positions shift back with collapses
+    size_t lead = keys ? keys->lead : 0;
+    size_t i = 0;
+
+    if (todo) {
+        if (!todo->len)
+            return;
+
+        i = todo_pos[next++];
+    } else if (keys) {
+        i = SweepKeys_from(keys, sw, 0);
+    }
+
+    while (i < Sweep_len(sw)) {
+        const ScopeMatch *m = Sweep_match(sw, i);
+
+        if (Sweep_collapses(sw, m, prec)) {
+            shift += m->len - 1;
+            Sweep_collapse(sw, i, m->rule, m->len, lead, o_stale);
+            continue;
+        }
+
+        if (!todo) {
+            i = keys ? SweepKeys_from(keys, sw, i + 1) : i + 1;
+            continue;
+        }
+
+        // positions within a collapse are gone
+        while (next < todo->len && todo_pos[next] <= i + shift)
+            ++next;
+
+        if (next == todo->len)
+            break;
+
+        i = todo_pos[next++] - shift;
+    }
+}
+
+/*
+ * sweeps `prec` right to left, collapsing matches as it goes. every match
+ * which goes stale is ahead of the sweep, so one sweep is always enough. the
+ * sweep visits the positions within reach of `keys` if it isn't NULL, or else
+ * every position
+ */
+static void Sweep_right(Sweep *sw, Prec prec, SweepKeys *keys) {
+    size_t i = Sweep_len(sw);
+    size_t low = keys ? i : 0; // visit every position down to this
+
+    if (keys)
+        keys->next = keys->len;
+
+    while (true) {
+        if (i > low) {
+            --i;
+        } else if (!keys || !i || !SweepKeys_until(keys, sw, i - 1, &i,
+                                                   &low)) {
+            break;
+        }
+
+        const ScopeMatch *m = Sweep_match(sw, i);
+
+        if (!Sweep_collapses(sw, m, prec))
+            continue;
+
+        Rule match = m->rule;
+        size_t match_len = m->len;
+
+        /*
+         * right associativity must check for backwards-reaching matches: for
+         * a rule that looks like `A* B`, if you have exprs that match
+         * `C A A A B`, right will first match the final `A B`, which is
+         * incorrect. this extends the match backwards until it stops
+         * matching the pattern.
+         */
+        while (i > 0) {
+            const ScopeMatch *back = Sweep_match(sw, i - 1);
+
+            if (back->rule.id != match.id || back->len != match_len + 1)
+                break;
+
+            ++match_len;
+            --i;
+        }
+
+        Sweep_collapse(sw, i, match, match_len, 0, NULL);
+
+        // keys after the collapse may now reach further back
+        if (keys)
+            low = MIN(low, i - MIN(i, keys->lead));
+
+        // retry the collapsed expr
+        ++i;
+    }
+}
+
+/*
+ * where each lexeme appears in a scope. lexeme `id` is at origins
+ * [offsets[id], offsets[id + 1]), in order
+ */
+typedef struct ScopeLexemes {
+    PosVec offsets, origins;
+    PosVec cursors; // for merging the origins of several lexemes
+} ScopeLexemes;
+
+static ScopeLexemes ScopeLexemes_new(const Lang *lang, AstExpr **exprs,
+                                     size_t len) {
+    ScopeLexemes sl = {
+        .offsets = PosVec_new(),
+        .origins = PosVec_new(),
+        .cursors = PosVec_new()
+    };
+    size_t num_ids = lang->num_lexemes + 1;
+
+    PosVec_reserve(&sl.offsets, num_ids + 1);
+    sl.offsets.len = num_ids + 1;
+
+    size_t *offsets = PosVec_data(&sl.offsets);
+
+    memset(offsets, 0, (num_ids + 1) * sizeof(*offsets));
+
+    for (size_t i = 0; i < len; ++i)
+        if (exprs[i]->type.id == fun_lexeme.id)
+            ++offsets[exprs[i]->lit.lexeme + 1];
+
+    for (size_t i = 0; i < num_ids; ++i)
+        offsets[i + 1] += offsets[i];
+
+    // place origins, using the start of each id as its cursor
+    PosVec_reserve(&sl.origins, offsets[num_ids]);
+    sl.origins.len = offsets[num_ids];
+
+    size_t *origins = PosVec_data(&sl.origins);
+
+    for (size_t i = 0; i < len; ++i)
+        if (exprs[i]->type.id == fun_lexeme.id)
+            origins[offsets[exprs[i]->lit.lexeme]++] = i;
+
+    // cursors now sit at the start of the next id
+    for (size_t i = num_ids; i > 0; --i)
+        offsets[i] = offsets[i - 1];
+
+    offsets[0] = 0;
+
+    return sl;
+}
+
+static void ScopeLexemes_del(ScopeLexemes *sl) {
+    PosVec_del(&sl->offsets);
+    PosVec_del(&sl->origins);
+    PosVec_del(&sl->cursors);
+}
+
+// gathers the origins of `prec`'s keys in the scope into `o_origins`, merging
+// those of each key lexeme in order. returns false if `prec` is unkeyed
+static bool ScopeLexemes_keys(ScopeLexemes *sl, const PrecKeys *keys,
+                              Prec prec, PosVec *o_origins,
+                              SweepKeys *o_keys) {
+    if (keys->max_lead[prec.id] == PREC_UNKEYED)
+        return false;
+
+    const size_t *offsets = PosVec_data(&sl->offsets);
+    const size_t *origins = PosVec_data(&sl->origins);
+    const unsigned *ids = &keys->lxm_ids[keys->offsets[prec.id]];
+    size_t num_ids = keys->offsets[prec.id + 1] - keys->offsets[prec.id];
+    size_t total = 0;
+
+    PosVec_clear(&sl->cursors);
+
+    for (size_t i = 0; i < num_ids; ++i) {
+        PosVec_push(&sl->cursors, offsets[ids[i]]);
+        total += offsets[ids[i] + 1] - offsets[ids[i]];
+    }
+
+    size_t *cursors = PosVec_data(&sl->cursors);
+
+    PosVec_clear(o_origins);
+    PosVec_reserve(o_origins, total);
+    o_origins->len = total;
+
+    size_t *merged = PosVec_data(o_origins);
+
+    for (size_t i = 0; i < total; ++i) {
+        // a prec has few keys, so the smallest is found by looking at each
+        size_t min = 0;
+
+        for (size_t j = 1; j < num_ids; ++j) {
+            if (cursors[j] < offsets[ids[j] + 1]
+             && (cursors[min] == offsets[ids[min] + 1]
+              || origins[cursors[j]] < origins[cursors[min]])) {
+                min = j;
+            }
+        }
+
+        merged[i] = origins[cursors[min]++];
+    }
+
+    *o_keys = (SweepKeys){
+        .origins = merged,
+        .len = total,
+        .lead = keys->max_lead[prec.id]
+    };
+
+    return true;
+}
+
+/*
+ * parse a slice of unparsed exprs into a tree, sweeping each prec from highest
+ * to lowest. a prec is skipped when none of its keys are in the scope, and
+ * otherwise only positions within reach of them are visited. left associative
+ * precs are swept until nothing changes, though after the first sweep only
+ * positions with stale matches are revisited.
+ */
+static AstExpr *parse_scope(AstCtx *ctx, AstExpr **slice, size_t len) {
     const Precs *precs = &ctx->lang->precs;
     const RuleTree *rules = &ctx->lang->rules;
-    AstExpr **slice = orig_slice;
+    ScopeMatchVec matches = ScopeMatchVec_new();
+    ScopeLexemes lexemes = ScopeLexemes_new(ctx->lang, slice, len);
+    PosVec todo = PosVec_new(), stale = PosVec_new();
+    PosVec key_origins = PosVec_new();
+
+    ScopeMatchVec_reserve(&matches, len);
+
+    for (size_t i = 0; i < len; ++i)
+        ScopeMatchVec_data(&matches)[i] = (ScopeMatch){ .origin = i };
+
+    Sweep sw = {
+        .ctx = ctx,
+        .rules = rules,
+        .exprs = slice,
+        .matches = ScopeMatchVec_data(&matches),
+        .cap = len
+    };
 
     Prec prec = Prec_highest(precs);
+    bool resweep = false, keyed = false;
+    SweepKeys keys;
 #ifdef DEBUG
     int iterations = 0;
 #endif
 
     while (true) {
-        bool found_match = false;
-
 #ifdef DEBUG
         ++iterations;
 #endif
 
-        if (Prec_assoc(precs, prec) == ASSOC_LEFT) {
-            for (size_t i = 0; i < len; ) {
-                Rule match;
-                size_t match_len = try_match(ctx, &slice[i], len - i, &match);
+        if (!resweep) {
+            keyed = ScopeLexemes_keys(&lexemes, &rules->prec_keys, prec,
+                                      &key_origins, &keys);
+        }
+
+        if (keyed && !keys.len) {
+            // none of the prec's keys are in the scope
+        } else if (Prec_assoc(precs, prec) == ASSOC_LEFT) {
+            Sweep_left(&sw, prec, resweep ? &todo : NULL,
+                       keyed ? &keys : NULL, &stale);
+        } else {
+            Sweep_right(&sw, prec, keyed ? &keys : NULL);
+        }
+
+        if (Prec_is_lowest(prec))
+           break;
+
+        // iterate
+        PosVec swap = todo;
+
+        todo = stale;
+        stale = swap;
+        PosVec_clear(&stale);
+
+        resweep = todo.len > 0;
+
+        if (!resweep)
+            Prec_dec(&prec);
+    }
+
+    // close the gap
+    Sweep_seek(&sw, Sweep_len(&sw));
+
+    ScopeMatchVec_del(&matches);
+    ScopeLexemes_del(&lexemes);
+    PosVec_del(&todo);
+    PosVec_del(&stale);
+    PosVec_del(&key_origins);
+
+    // return AstExpr block as a scope
+    return rule_copy_of_slice(ctx->pool, rules, rules->rule_scope, sw.exprs,
+                              sw.gap);
+}
+
+// precedence climbing =========================================================
+
+/*
+ * single pass alternative to parse_scope for PARSE_CLIMB langs, which binds
+ * exprs the way parse_scope's sweeps would:
+ * - a rule only takes operands from its own prec or higher
+ * - the trailing operand of a left associative rule doesn't continue with
+ *   rules of the same prec, unless it starts with a prefix rule of that prec
+ *   (parse_scope forms it in an earlier sweep then)
+ * - parse_scope sweeps a left associative prec until nothing changes (the
+ *   lowest only once), so a rule only takes optional operands which an
+ *   earlier sweep formed. `round` tracks which sweep of its prec forms an
+ *   expr, atoms and higher precs being round 0
+ * - a longer match of another prec blocks a rule, see climb_blocked
+ * lexemes which can't start or continue an expr stay in the scope as is.
+ */
+
+#define CLIMB_MEMO_MIN 64
+
+// a climb_expr result, key is 0 for an empty slot
+typedef struct ClimbMemo {
+    size_t key, end;
+    AstExpr *expr;
+    unsigned round;
+} ClimbMemo;
+
+typedef struct Climber {
+    AstCtx *ctx;
+    const ClimbTable *table;
+    AstExpr **items;
+    size_t len, pos;
+
+    // children of the rules being matched
+    AstExprVec stack;
+    // every expr is built here, since most are operands of rules which don't
+    // win. climb_scope copies the ones it keeps to ctx->pool
+    Bump scratch;
+
+    // climb_expr results by (pos, min_prec, strict), open addressed. rules
+    // and the blocked check try the same operands over and over, which is
+    // exponential in the nesting without this. with it, each key is climbed
+    // once. a result only depends on the items from pos on, which climb_scope
+    // doesn't write until it moves past them
+    ClimbMemo *memo;
+    size_t memo_len, memo_cap;
+} Climber;
+
+typedef struct ClimbMatch {
+    AstExpr *expr;
+    size_t end;
+    unsigned round;
+} ClimbMatch;
+
+#define ATOM_PREC UINT_MAX
+
+static unsigned prec_of(const Climber *cl, const AstExpr *expr) {
+    if (AstExpr_is_atom(expr))
+        return ATOM_PREC;
+
+    return Rule_get(&cl->ctx->lang->rules, expr->rule)->prec.id;
+}
+
+static unsigned round_within(const Climber *cl, const AstExpr *expr,
+                             unsigned round, unsigned prec) {
+    return prec_of(cl, expr) == prec ? round : 0;
+}
+
+static AstExpr *climb_expr(Climber *, unsigned min_prec, bool strict,
+                           unsigned *o_round);
+
+// matches `cr` at cl->pos, following `lead` if it isn't a prefix rule.
+// returns NULL and leaves cl->pos alone on failure
+static AstExpr *climb_rule(Climber *cl, const ClimbRule *cr, AstExpr *lead,
+                           unsigned lead_round, unsigned *o_round) {
+    const Pattern *pat = cr->pat;
+    size_t start = cl->pos, base = cl->stack.len;
+    // parse_scope sweeps right associative precs once
+    unsigned delay = cr->right ? 0 : 1;
+    unsigned round = 1;
+    size_t i = 0;
+
+    if (lead) {
+        if (!MatchAtom_matches_rule(&pat->matches[0], lead))
+            return NULL;
+
+        AstExprVec_push(&cl->stack, lead);
+        round = MAX(round, round_within(cl, lead, lead_round, cr->prec));
+        i = 1;
+    }
+
+    for (; i < pat->len; ++i) {
+        const MatchAtom *pred = &pat->matches[i];
 
-                if (match_len && Rule_get(rules, match)->prec.id == prec.id) {
-                    found_match = true;
+        if (pred->type == MATCH_LEXEME) {
+            if (cl->pos == cl->len
+             || !MatchAtom_matches_rule(pred, cl->items[cl->pos]))
+                goto fail;
+
+            AstExprVec_push(&cl->stack, cl->items[cl->pos++]);
+            continue;
+        }
 
-                    // collapse rule
-                    size_t match_diff = match_len - 1;
+        bool strict = i + 1 == pat->len && !cr->right;
 
-                    slice[i + match_diff] =
-                        rule_copy_of_slice(ctx->pool, rules, match, &slice[i],
-                                           match_len);
+        for (size_t count = 0; ; ++count) {
+            bool required = count == 0 && !pred->optional;
+            size_t save = cl->pos;
+            unsigned child_round;
+            AstExpr *child = climb_expr(cl, cr->prec, strict, &child_round);
 
-                    for (int j = i - 1; j >= 0; --j)
-                        slice[j + match_diff] = slice[j];
+            if (child && MatchAtom_matches_rule(pred, child)) {
+                unsigned formed =
+                    round_within(cl, child, child_round, cr->prec) + delay;
 
-                    slice += match_diff;
-                    len -= match_diff;
-                } else {
-                    ++i;
+                if (required || formed <= round) {
+                    round = MAX(round, formed);
+                    AstExprVec_push(&cl->stack, child);
+
+                    if (pred->repeating)
+                        continue;
+
+                    break;
                 }
             }
-        } else { // right assoc
-            for (int i = len - 1; i >= 0; ) {
-                Rule match;
-                size_t match_len = try_match(ctx, &slice[i], len - i, &match);
-
-                if (match_len && Rule_get(rules, match)->prec.id == prec.id) {
-                    found_match = true;
-
-                    /*
-                     * right associativity must check for backwards-reaching
-                     * matches: for a rule that looks like `A* B`, if you have
-                     * exprs that match `C A A A B`, right will first match the
-                     * final `A B`, which is incorrect. this code chunk will
-                     * extend the match backwards until it stops matching the
-                     * pattern.
-                     */
-try_back_match:
-                    if (i > 0) {
-                        Rule back_match;
-                        size_t back_match_len =
-                            try_match(ctx, &slice[i - 1], len - (i - 1),
-                                      &back_match);
-
-                        if (back_match.id == match.id
-                         && back_match_len == match_len + 1) {
-                            ++match_len;
-                            --i;
-                            goto try_back_match;
-                        }
-                    }
-
-                    // collapse rule
-                    slice[i] = rule_copy_of_slice(ctx->pool, rules, match,
-                                                  &slice[i], match_len);
-
-                    size_t match_diff = match_len - 1;
-
-                    for (size_t j = i + 1; j < len - match_diff; ++j)
-                        slice[j] = slice[j + match_diff];
-
-                    len -= match_diff;
-                } else {
-                    --i;
-                }
+
+            cl->pos = save;
+
+            if (required)
+                goto fail;
+
+            break;
+        }
+    }
+
+    // parse_scope stops after one sweep of the lowest prec
+    if (cr->prec == 0 && round > 1)
+        goto fail;
+
+    const RuleTree *rules = &cl->ctx->lang->rules;
+    AstExpr *expr =
+        rule_copy_of_slice(&cl->scratch, rules, cr->rule,
+                           &AstExprVec_data(&cl->stack)[base],
+                           cl->stack.len - base);
+
+    cl->stack.len = base;
+    *o_round = round;
+
+    return expr;
+
+fail:
+    cl->stack.len = base;
+    cl->pos = start;
+
+    return NULL;
+}
+
+// tries each rule the prec bounds allow at cl->pos, keeping the longest match
+// in `best`. cl->pos is left alone
+static void climb_longest(Climber *cl, ClimbRules rules, AstExpr *lead,
+                          unsigned lead_round, unsigned min_prec,
+                          unsigned max_prec, ClimbMatch *best) {
+    size_t start = cl->pos;
+
+    for (size_t i = 0; i < rules.len; ++i) {
+        const ClimbRule *cr = &rules.rules[i];
+
+        if (cr->prec < min_prec || cr->prec > max_prec)
+            continue;
+
+        unsigned round;
+        AstExpr *expr = climb_rule(cl, cr, lead, lead_round, &round);
+
+        if (expr && (!best->expr || cl->pos > best->end)) {
+            *best = (ClimbMatch){
+                .expr = expr,
+                .end = cl->pos,
+                .round = round
+            };
+        }
+
+        cl->pos = start;
+    }
+}
+
+// number of exprs `cr` spans at cl->pos as parse_scope sees them while it
+// sweeps `prec`, with only higher precs formed. 0 if it doesn't match
+static size_t sweep_match_len(Climber *cl, const ClimbRule *cr, AstExpr *lead,
+                              unsigned prec) {
+    const Pattern *pat = cr->pat;
+    size_t start = cl->pos, len = 0;
+    size_t i = 0;
+
+    if (lead) {
+        if (!MatchAtom_matches_rule(&pat->matches[0], lead))
+            return 0;
+
+        len = i = 1;
+    }
+
+    for (; i < pat->len; ++i) {
+        const MatchAtom *pred = &pat->matches[i];
+
+        if (pred->type == MATCH_LEXEME) {
+            if (cl->pos == cl->len
+             || !MatchAtom_matches_rule(pred, cl->items[cl->pos]))
+                goto fail;
+
+            ++cl->pos;
+            ++len;
+            continue;
+        }
+
+        for (size_t count = 0; ; ++count) {
+            size_t save = cl->pos;
+            unsigned round;
+            AstExpr *child = climb_expr(cl, prec + 1, false, &round);
+
+            if (child && MatchAtom_matches_rule(pred, child)) {
+                ++len;
+
+                if (pred->repeating)
+                    continue;
+
+                break;
             }
+
+            cl->pos = save;
+
+            if (count == 0 && !pred->optional)
+                goto fail;
+
+            break;
         }
+    }
 
-        if (Prec_is_lowest(prec))
-           break;
+    cl->pos = start;
 
-        // iterate
-        if (found_match)
-            found_match = false;
-        else
-            Prec_dec(&prec);
+    return len;
+
+fail:
+    cl->pos = start;
+
+    return 0;
+}
+
+// parse_scope only collapses the longest match at a position, so a match of
+// `prec` is blocked by a longer one of another prec, even one which can't
+// form there
+static bool climb_blocked(Climber *cl, ClimbRules rules, AstExpr *lead,
+                          unsigned prec, size_t len) {
+    // an uncontested key only holds rules of `prec`, or none of them
+    if (!rules.contested && (!rules.len || rules.rules[0].prec == prec))
+        return false;
+
+    for (size_t i = 0; i < rules.len; ++i) {
+        const ClimbRule *cr = &rules.rules[i];
+
+        if (cr->prec != prec && cr->max_len > len
+         && sweep_match_len(cl, cr, lead, prec) > len)
+            return true;
     }
 
-    // return AstExpr block as a scope
-    return rule_copy_of_slice(ctx->pool, rules, rules->rule_scope, slice, len);
+    return false;
+}
+
+// climb_expr without the memo
+static AstExpr *climb_expr_uncached(Climber *cl, unsigned min_prec,
+                                    bool strict, unsigned *o_round) {
+    AstExpr *lhs = cl->items[cl->pos];
+    unsigned round = 0;
+
+    if (lhs->type.id == fun_lexeme.id) {
+        ClimbRules prefix = Climb_prefix(cl->table, lhs->lit.lexeme);
+        ClimbMatch best = {0};
+
+        climb_longest(cl, prefix, NULL, 0, min_prec, ATOM_PREC, &best);
+
+        if (!best.expr
+         || climb_blocked(cl, prefix, NULL, prec_of(cl, best.expr),
+                          best.expr->len))
+            return NULL;
+
+        lhs = best.expr;
+        round = best.round;
+        cl->pos = best.end;
+
+        if (prec_of(cl, lhs) == min_prec)
+            strict = false;
+    } else {
+        ++cl->pos;
+    }
+
+    // extend lhs with infix and chain rules
+    unsigned min_ext = strict ? min_prec + 1 : min_prec;
+
+    while (true) {
+        ClimbRules infix = {0}, chains = Climb_chains(cl->table);
+        ClimbMatch best = {0};
+        unsigned max_ext = prec_of(cl, lhs);
+        const AstExpr *next = cl->pos < cl->len ? cl->items[cl->pos] : NULL;
+
+        if (next && next->type.id == fun_lexeme.id)
+            infix = Climb_infix(cl->table, next->lit.lexeme);
+
+        climb_longest(cl, infix, lhs, round, min_ext, max_ext, &best);
+        climb_longest(cl, chains, lhs, round, min_ext, max_ext, &best);
+
+        if (!best.expr)
+            break;
+
+        unsigned best_prec = prec_of(cl, best.expr);
+
+        if (climb_blocked(cl, infix, lhs, best_prec, best.expr->len)
+         || climb_blocked(cl, chains, lhs, best_prec, best.expr->len))
+            break;
+
+        lhs = best.expr;
+        round = best.round;
+        cl->pos = best.end;
+    }
+
+    *o_round = round;
+
+    return lhs;
+}
+
+static ClimbMemo *memo_slot(ClimbMemo *memo, size_t cap, size_t key) {
+    size_t i = (key * 0x9e3779b97f4a7c15) >> 32;
+
+    while (true) {
+        ClimbMemo *slot = &memo[i & (cap - 1)];
+
+        if (slot->key == key || !slot->key)
+            return slot;
+
+        ++i;
+    }
+}
+
+static void memo_put(Climber *cl, ClimbMemo entry) {
+    if (cl->memo_len * 2 >= cl->memo_cap) {
+        ClimbMemo *old = cl->memo;
+        size_t old_cap = cl->memo_cap;
+
+        cl->memo_cap = old_cap * 2;
+        cl->memo = calloc(cl->memo_cap, sizeof(*cl->memo));
+
+        for (size_t i = 0; i < old_cap; ++i)
+            if (old[i].key)
+                *memo_slot(cl->memo, cl->memo_cap, old[i].key) = old[i];
+
+        free(old);
+    }
+
+    *memo_slot(cl->memo, cl->memo_cap, entry.key) = entry;
+    ++cl->memo_len;
+}
+
+// entries for items climb_scope has moved past are dead. the table is cut down
+// to the size the last expr needed, so clearing costs what filling it did
+static void memo_clear(Climber *cl) {
+    size_t cap = CLIMB_MEMO_MIN;
+
+    while (cap < cl->memo_len * 2)
+        cap *= 2;
+
+    if (cap < cl->memo_cap) {
+        free(cl->memo);
+        cl->memo = calloc(cap, sizeof(*cl->memo));
+        cl->memo_cap = cap;
+    } else {
+        memset(cl->memo, 0, cl->memo_cap * sizeof(*cl->memo));
+    }
+
+    cl->memo_len = 0;
+}
+
+// parses an operand of `min_prec` at cl->pos, returns NULL and leaves cl->pos
+// alone if the lexeme there can't start one. a strict operand doesn't
+// continue with rules of `min_prec`
+static AstExpr *climb_expr(Climber *cl, unsigned min_prec, bool strict,
+                           unsigned *o_round) {
+    if (cl->pos == cl->len)
+        return NULL;
+
+    size_t num_precs = cl->ctx->lang->precs.len + 1;
+    size_t key = (cl->pos * num_precs + min_prec) * 2 + strict + 1;
+    const ClimbMemo *slot = memo_slot(cl->memo, cl->memo_cap, key);
+
+    if (slot->key == key) {
+        cl->pos = slot->end;
+        *o_round = slot->round;
+
+        return slot->expr;
+    }
+
+    // nested climbs are always keyed further on, so `key` is still missing
+    AstExpr *expr = climb_expr_uncached(cl, min_prec, strict, o_round);
+
+    memo_put(cl, (ClimbMemo){
+        .key = key,
+        .end = cl->pos,
+        .expr = expr,
+        .round = *o_round
+    });
+
+    return expr;
+}
+
+// copies the exprs climbing built under `expr` out of the scratch pool
+static AstExpr *climb_keep(Bump *pool, const AstExpr *expr) {
+    // atoms (scopes included) are already in the parse pool
+    if (AstExpr_is_atom(expr))
+        return (AstExpr *)expr;
+
+    AstExpr *copy = BUMP_NEW(pool, AstExpr);
+
+    *copy = *expr;
+    copy->exprs = BUMP_ARRAY(pool, AstExpr *, expr->len);
+
+    for (size_t i = 0; i < expr->len; ++i)
+        copy->exprs[i] = climb_keep(pool, expr->exprs[i]);
+
+    return copy;
+}
+
+static AstExpr *climb_scope(AstCtx *ctx, AstExpr **items, size_t len) {
+    const RuleTree *rules = &ctx->lang->rules;
+    Climber cl = {
+        .ctx = ctx,
+        .table = &ctx->lang->climb,
+        .items = items,
+        .len = len,
+        .stack = AstExprVec_new(),
+        .scratch = Bump_new(),
+        .memo_cap = CLIMB_MEMO_MIN
+    };
+
+    cl.memo = calloc(cl.memo_cap, sizeof(*cl.memo));
+
+    // exprs are written back over the items they were built from
+    size_t scope_len = 0;
+
+    while (cl.pos < len) {
+        unsigned round;
+        AstExpr *expr = climb_expr(&cl, 0, false, &round);
+
+        expr = expr ? climb_keep(ctx->pool, expr) : items[cl.pos++];
+        items[scope_len++] = expr;
+
+        if (cl.memo_len)
+            memo_clear(&cl);
+    }
+
+    AstExprVec_del(&cl.stack);
+    Bump_del(&cl.scratch);
+    free(cl.memo);
+
+    return rule_copy_of_slice(ctx->pool, rules, rules->rule_scope, items,
+                              scope_len);
 }
 
 // interface ===================================================================
@@ -311,9 +1210,13 @@ AstExpr *parse(AstCtx *ctx, const TokBuf *tb) {
         start_mem = ctx->pool->total;
     );
 
-    Vec scope = gen_initial_scope(ctx, tb);
-    AstExpr *ast = parse_scope(ctx, (AstExpr **)scope.data, scope.len);
-    Vec_del(&scope);
+    assert(ctx->lang->engine != PARSE_CLIMB || ctx->lang->climbable);
+
+    AstExprVec scope = gen_initial_scope(ctx, tb);
+    AstExpr *ast = ctx->lang->engine == PARSE_CLIMB
+        ? climb_scope(ctx, AstExprVec_data(&scope), scope.len)
+        : parse_scope(ctx, AstExprVec_data(&scope), scope.len);
+    AstExprVec_del(&scope);
 
     assert(ast->type.id == ID_SCOPE && ast->evaltype.id != ID_RAW_SCOPE);
 
@@ -25,8 +25,9 @@ static bool check_evaltype(const SemaCtx *ctx, const AstExpr *model,
 static bool pattern_check_and_infer(const SemaCtx *ctx, AstExpr *expr,
                                     const Pattern *pat) {
     // store match forms (indices into pattern->matches corresponding to each
-    // child)
-    size_t *match_forms = malloc(expr->len * sizeof(*match_forms));
+    // child) as scratch memory, rolled back before returning
+    BumpMark scratch = Bump_mark(ctx->pool);
+    size_t *match_forms = BUMP_ARRAY(ctx->pool, size_t, expr->len);
 
     if (pat->len == expr->len) {
         for (size_t i = 0; i < expr->len; ++i)
@@ -39,12 +40,10 @@ static bool pattern_check_and_infer(const SemaCtx *ctx, AstExpr *expr,
 
             if (pred->repeating) {
                 while (idx < expr->len
-                    && MatchAtom_matches_rule(ctx->file, pred,
-                                              expr->exprs[idx])) {
+                    && MatchAtom_matches_rule(pred, expr->exprs[idx])) {
                     match_forms[idx++] = i;
                 }
-            } else if (MatchAtom_matches_rule(ctx->file, pred,
-                                              expr->exprs[idx])) {
+            } else if (MatchAtom_matches_rule(pred, expr->exprs[idx])) {
                 match_forms[idx++] = i;
             }
         }
@@ -55,7 +54,7 @@ static bool pattern_check_and_infer(const SemaCtx *ctx, AstExpr *expr,
         const AstExpr *child = expr->exprs[i];
         const MatchAtom *pred = &pat->matches[match_forms[i]];
 
-        if (!MatchAtom_matches_type(ctx->file, pred, child)) {
+        if (!MatchAtom_matches_type(pred, child)) {
             // TODO make this error better, will require some error api work
             AstExpr_error(ctx->file, child, "invalid evaltype");
 
@@ -65,6 +64,8 @@ static bool pattern_check_and_infer(const SemaCtx *ctx, AstExpr *expr,
             TypeExpr_print(pred->type_expr);
             printf("\n");
 
+            Bump_reset_to(ctx->pool, scratch);
+
             return false;
         }
     }
@@ -92,8 +93,11 @@ static bool pattern_check_and_infer(const SemaCtx *ctx, AstExpr *expr,
                 while (match_forms[idx] == constrained && idx < expr->len) {
                     if (!model)
                         model = expr->exprs[idx];
-                    else if (!check_evaltype(ctx, model, expr->exprs[idx]))
+                    else if (!check_evaltype(ctx, model, expr->exprs[idx])) {
+                        Bump_reset_to(ctx->pool, scratch);
+
                         return false;
+                    }
 
                     ++idx;
                 }
@@ -106,7 +110,7 @@ static bool pattern_check_and_infer(const SemaCtx *ctx, AstExpr *expr,
         }
     }
 
-    free(match_forms);
+    Bump_reset_to(ctx->pool, scratch);
 
     // evaltype is uninferred
     if (!inferred_ret) {
@@ -75,7 +75,7 @@ static void copy_entry_to(Bump *pool, NameEntry *dst, const NameEntry *entry) {
 static void put_entry(Names *names, const NameEntry *entry) {
     if (!names || !names->level) {
         // put globally
-        NameEntry *copy = Bump_alloc(&globals_pool, sizeof(*copy));
+        NameEntry *copy = BUMP_NEW(&globals_pool, NameEntry);
         copy_entry_to(&globals_pool, copy, entry);
 
         HashMap_put(&globals, entry->name, copy);
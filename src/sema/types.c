@@ -6,23 +6,42 @@
 
 typedef struct TypeEntry {
     const Word *name;
-
-    // Type ids for the types that this type implements
-    IdSet impls;
+    bool has_supers;
 } TypeEntry;
 
 Bump type_pool;
 Vec type_entries; // Vec<Word *>
 
+/*
+ * transitively closed subtype matrix; bit `of` in row `ty` is set if `ty`
+ * implements `of`. supertypes must be defined before their subtypes, so a row
+ * only needs bits for lower ids, never changes after Type_define, and the
+ * matrix can be stored triangularly.
+ */
+#define IMPL_BITS 64
+#define INIT_IMPLS_CAP 64
+
+static uint64_t *impl_bits;
+static size_t impl_bits_len, impl_bits_cap;
+static size_t *impl_rows; // offset of each type's row into impl_bits
+static size_t impl_rows_cap;
+
+static size_t impl_row_words(unsigned id) {
+    return (id + IMPL_BITS - 1) / IMPL_BITS;
+}
+
 void types_init(void) {
     type_pool = Bump_new();
     type_entries = Vec_new();
+
+    impl_bits_cap = impl_rows_cap = INIT_IMPLS_CAP;
+    impl_bits = malloc(impl_bits_cap * sizeof(*impl_bits));
+    impl_rows = malloc(impl_rows_cap * sizeof(*impl_rows));
 }
 
 void types_quit(void) {
-    for (size_t i = 0; i < type_entries.len; ++i)
-        IdSet_del(&((TypeEntry *)type_entries.data[i])->impls);
-
+    free(impl_bits);
+    free(impl_rows);
     Vec_del(&type_entries);
     Bump_del(&type_pool);
 }
@@ -35,14 +54,11 @@ void types_dump(void) {
 
         printf("%.*s", (int)entry->name->len, entry->name->str);
 
-        if (entry->impls.size > 0) {
+        if (entry->has_supers) {
             printf(" ::");
 
-            for (size_t j = 0; j < type_entries.len; ++j) {
-                if (j == i)
-                    continue;
-
-                if (IdSet_has(&entry->impls, j)) {
+            for (size_t j = 0; j < i; ++j) {
+                if (Type_is((Type){ i }, (Type){ j })) {
                     const Word *name = Type_name((Type){ j });
 
                     printf(" %.*s", (int)name->len, name->str);
@@ -64,19 +80,53 @@ const Word *Type_name(Type ty) {
     return Type_get(ty)->name;
 }
 
+// adds a row to the subtype matrix for a newly defined type
+static void define_impls(Type ty, Type *supers, size_t num_supers) {
+    size_t words = impl_row_words(ty.id);
+
+    if (ty.id == impl_rows_cap) {
+        impl_rows_cap *= 2;
+        impl_rows = realloc(impl_rows, impl_rows_cap * sizeof(*impl_rows));
+    }
+
+    if (impl_bits_len + words > impl_bits_cap) {
+        while (impl_bits_len + words > impl_bits_cap)
+            impl_bits_cap *= 2;
+
+        impl_bits = realloc(impl_bits, impl_bits_cap * sizeof(*impl_bits));
+    }
+
+    uint64_t *row = &impl_bits[impl_bits_len];
+
+    impl_rows[ty.id] = impl_bits_len;
+    impl_bits_len += words;
+
+    memset(row, 0, words * sizeof(*row));
+
+    // this type implements each super and everything each super implements
+    for (size_t i = 0; i < num_supers; ++i) {
+        unsigned super = supers[i].id;
+        const uint64_t *super_row = &impl_bits[impl_rows[super]];
+
+        assert(super < ty.id);
+
+        row[super / IMPL_BITS] |= (uint64_t)1 << (super % IMPL_BITS);
+
+        for (size_t j = 0; j < impl_row_words(super); ++j)
+            row[j] |= super_row[j];
+    }
+}
+
 Type Type_define(Names *names, Word name, Type *supers, size_t num_supers) {
     Type handle = { type_entries.len };
-    TypeEntry *entry = Bump_alloc(&type_pool, sizeof(*entry));
+    TypeEntry *entry = BUMP_NEW(&type_pool, TypeEntry);
 
     *entry = (TypeEntry){
         .name = Word_copy_of(&name, &type_pool),
-        .impls = IdSet_new()
+        .has_supers = num_supers > 0
     };
 
-    for (size_t i = 0; i < num_supers; ++i) {
-        IdSet_add_superset(&Type_get(supers[i])->impls, &entry->impls);
-        IdSet_put(&entry->impls, supers[i].id);
-    }
+    define_impls(handle, supers, num_supers);
 
     Vec_push(&type_entries, entry);
     Names_define_type(names, &name, TypeExpr_atom(&names->pool, handle));
@@ -85,7 +135,7 @@ Type Type_define(Names *names, Word name, Type *supers, size_t num_supers) {
 }
 
 TypeExpr *TypeExpr_deepcopy(Bump *pool, const TypeExpr *expr) {
-    TypeExpr *copy = Bump_alloc(pool, sizeof(*copy));
+    TypeExpr *copy = BUMP_NEW(pool, TypeExpr);
 
     copy->type = expr->type;
 
@@ -95,7 +145,7 @@ TypeExpr *TypeExpr_deepcopy(Bump *pool, const TypeExpr *expr) {
         break;
     case TET_SUM:
         copy->len = expr->len;
-        copy->exprs = Bump_alloc(pool, copy->len * sizeof(*copy->exprs));
+        copy->exprs = BUMP_ARRAY(pool, TypeExpr *, copy->len);
 
         for (size_t i = 0; i < expr->len; ++i)
             copy->exprs[i] = TypeExpr_deepcopy(pool, expr->exprs[i]);
@@ -125,7 +175,14 @@ bool TypeExpr_deepequals(const TypeExpr *expr, const TypeExpr *other) {
 
 bool Type_is(Type ty, Type of) {
     // either types are equivalent, or `ty` subtypes `of`
-    return ty.id == of.id || IdSet_has(&Type_get(ty)->impls, of.id);
+    if (ty.id == of.id)
+        return true;
+    else if (of.id > ty.id)
+        return false;
+
+    uint64_t word = impl_bits[impl_rows[ty.id] + of.id / IMPL_BITS];
+
+    return (word >> (of.id % IMPL_BITS)) & 1;
 }
 
 bool TypeExpr_is(const TypeExpr *expr, Type of) {
@@ -195,7 +252,7 @@ bool TypeExpr_equals(const TypeExpr *a, const TypeExpr *b) {
 }
 
 TypeExpr *TypeExpr_atom(Bump *pool, Type ty) {
-    TypeExpr *te = Bump_alloc(pool, sizeof(*te));
+    TypeExpr *te = BUMP_NEW(pool, TypeExpr);
 
     te->type = TET_ATOM;
     te->atom = ty;
@@ -204,10 +261,10 @@ TypeExpr *TypeExpr_atom(Bump *pool, Type ty) {
 }
 
 static TypeExpr *TE_copy_va_list(Bump *pool, size_t n, va_list argp) {
-    TypeExpr *te = Bump_alloc(pool, sizeof(*te));
+    TypeExpr *te = BUMP_NEW(pool, TypeExpr);
 
     te->len = n;
-    te->exprs = Bump_alloc(pool, te->len * sizeof(*te->exprs));
+    te->exprs = BUMP_ARRAY(pool, TypeExpr *, te->len);
 
     for (size_t i = 0; i < te->len; ++i)
         te->exprs[i] = va_arg(argp, TypeExpr *);
@@ -39,27 +39,101 @@ void fungus_panic(const char *msg, ...) {
     exit(-1);
 }
 
-#define FNV_PRIME 1099511628211ull
-#define FNV_BASIS 14695981039346656037ull
+#define WH_SEED 0xa0761d6478bd642full
+#define WH_P0 0xe7037ed1a0b428dbull
+#define WH_P1 0x8ebc6af09c88c6e3ull
+#define WH_P2 0x589965cc75374cc3ull
 
-// fnv-1a
-hash_t fnv_hash_start(void) {
-    return FNV_BASIS;
+#ifdef __SIZEOF_INT128__
+__extension__ typedef unsigned __int128 u128;
+#endif
+
+// 64x64 -> 128 bit multiply, folded back to 64 bits
+static inline uint64_t wh_mum(uint64_t a, uint64_t b) {
+#ifdef __SIZEOF_INT128__
+    u128 r = (u128)a * b;
+
+    return (uint64_t)r ^ (uint64_t)(r >> 64);
+#else
+    uint64_t ha = a >> 32, la = (uint32_t)a;
+    uint64_t hb = b >> 32, lb = (uint32_t)b;
+    uint64_t hi = ha * hb, mid0 = ha * lb, mid1 = hb * la, lo = la * lb;
+
+    uint64_t t = lo + (mid0 << 32);
+    uint64_t carry = t < lo;
+
+    lo = t + (mid1 << 32);
+    carry += lo < t;
+    hi += (mid0 >> 32) + (mid1 >> 32) + carry;
+
+    return lo ^ hi;
+#endif
 }
 
-hash_t fnv_hash_next(hash_t hash, char byte) {
-    hash ^= (hash_t)byte;
-    hash *= FNV_PRIME;
+static inline uint64_t wh_read8(const char *data) {
+    uint64_t block;
 
-    return hash;
+    memcpy(&block, data, sizeof(block));
+
+    return block;
 }
 
+static inline uint64_t wh_read4(const char *data) {
+    uint32_t block;
+
+    memcpy(&block, data, sizeof(block));
+
+    return block;
+}
+
+// packs a partial block of 0-7 bytes with fixed size loads, the length is mixed
+// in separately so overlapping reads are fine
+static inline uint64_t wh_read_tail(const char *data, size_t nbytes) {
+    const unsigned char *bytes = (const unsigned char *)data;
+
+    if (nbytes >= 4)
+        return wh_read4(data) << 32 | wh_read4(&data[nbytes - 4]);
+    else if (nbytes)
+        return (uint64_t)bytes[0] << 16 | (uint64_t)bytes[nbytes / 2] << 8
+             | bytes[nbytes - 1];
+
+    return 0;
+}
+
+static inline hash_t wh_block(hash_t state, uint64_t block) {
+    return wh_mum(block ^ WH_P0, state ^ WH_P1);
+}
+
+// mixes the trailing partial block and total length into the state
+static inline hash_t wh_final(hash_t state, const char *tail, size_t tail_len,
+                              size_t len) {
+    hash_t hash =
+        wh_mum(wh_read_tail(tail, tail_len) ^ WH_P0, state ^ WH_P1 ^ len);
+
+    return wh_mum(hash ^ WH_P2, WH_P0);
+}
+
+hash_t word_hash(const char *data, size_t nbytes) {
+    hash_t state = WH_SEED;
+    size_t i = 0;
+
+    for (; i + 8 <= nbytes; i += 8)
+        state = wh_block(state, wh_read8(&data[i]));
+
+    return wh_final(state, &data[i], nbytes - i, nbytes);
+}
+
+#define FNV_PRIME 1099511628211ull
+#define FNV_BASIS 14695981039346656037ull
+
+// fnv-1a
 hash_t fnv_hash(const char *data, size_t nbytes) {
-    hash_t hash = fnv_hash_start();
+    hash_t hash = FNV_BASIS;
 
-    for (size_t i = 0; i < nbytes; ++i)
-        hash = fnv_hash_next(hash, data[i]);
+    for (size_t i = 0; i < nbytes; ++i) {
+        hash ^= (hash_t)data[i];
+        hash *= FNV_PRIME;
+    }
 
     return hash;
 }
-
@@ -92,10 +92,10 @@ noreturn void fungus_panic(const char *msg, ...);
 
 typedef uint64_t hash_t;
 
-hash_t fnv_hash(const char *data, size_t nbytes);
+// hashes 8 bytes per multiply (after wyhash), used for every Word
+hash_t word_hash(const char *data, size_t nbytes);
 
-// hash a byte at a time
-hash_t fnv_hash_start(void);
-hash_t fnv_hash_next(hash_t, char byte);
+// fnv-1a, kept as a reference for bench/hash
+hash_t fnv_hash(const char *data, size_t nbytes);
 
 #endif
@@ -0,0 +1,256 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "fungus.h"
+#include "lex.h"
+#include "parse.h"
+#include "lang/ast_expr.h"
+
+/*
+ * parses random fungus with both engines of fungus_lang. PARSE_CLIMB must
+ * build exactly the AST PARSE_SWEEP does, and fail exactly when it does.
+ */
+
+#define NUM_CASES 4000
+#define MAX_DEPTH 6
+#define MAX_SOUP 30
+// terms of the long chains, which climb_expr's memo keeps from blowing up
+#define CHAIN_TERMS 2000
+
+static const char *atoms[] = {
+    "a", "b", "x", "1", "2.5", "true", "\"s\"", "`+", "{ 1 }",
+};
+
+static const char *infix[] = {
+    "==", "!=", "<", ">", "<=", ">=", "or", "and", "+", "-", "*", "/", "%", "=",
+};
+
+// soups are mostly nonsense, which exercises what can't bind as much as what
+// can
+static const char *soup_words[] = {
+    "==", "!=", "<", ">", "<=", ">=", "or", "and", "+", "-", "*", "/", "%", "=",
+    "(", ")", "!", "let", "val", "const", "if", "elif", "else", "a", "b", "1",
+    "{ 1 }", "x", "`+",
+};
+
+static uint64_t rng_state = 0x2545f4914f6cdd1d;
+
+static size_t rng(size_t n) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+
+    return rng_state % n;
+}
+
+typedef struct Text {
+    char *str;
+    size_t len, cap;
+} Text;
+
+static void put(Text *t, const char *str) {
+    size_t len = strlen(str);
+
+    if (t->len + len > t->cap) {
+        t->cap = (t->len + len) * 2;
+        t->str = realloc(t->str, t->cap);
+    }
+
+    memcpy(&t->str[t->len], str, len);
+    t->len += len;
+}
+
+static void gen_expr(Text *t, size_t depth) {
+    size_t kind = depth ? rng(9) : 0;
+
+    switch (kind) {
+    case 0:
+        put(t, atoms[rng(ARRAY_SIZE(atoms))]);
+        break;
+    case 1: case 2: case 3:
+        gen_expr(t, depth - 1);
+        put(t, " ");
+        put(t, infix[rng(ARRAY_SIZE(infix))]);
+        put(t, " ");
+        gen_expr(t, depth - 1);
+        break;
+    case 4:
+        put(t, "(");
+        gen_expr(t, depth - 1);
+        put(t, ")");
+        break;
+    case 5:
+        put(t, "!");
+        gen_expr(t, depth - 1);
+        break;
+    case 6:
+        put(t, (const char *[]){ "let", "val", "const" }[rng(3)]);
+        put(t, " x = ");
+        gen_expr(t, depth - 1);
+        break;
+    case 7:
+        put(t, "if ");
+        gen_expr(t, depth - 1);
+        put(t, " { ");
+        gen_expr(t, depth - 1);
+        put(t, " }");
+
+        for (size_t i = rng(3); i > 0; --i) {
+            put(t, " elif ");
+            gen_expr(t, depth - 1);
+            put(t, " { 2 }");
+        }
+
+        if (rng(2))
+            put(t, " else { 3 }");
+
+        break;
+    default:
+        put(t, "a = ");
+        gen_expr(t, depth - 1);
+        break;
+    }
+}
+
+static void gen_soup(Text *t) {
+    for (size_t i = 1 + rng(MAX_SOUP); i > 0; --i) {
+        put(t, soup_words[rng(ARRAY_SIZE(soup_words))]);
+        put(t, " ");
+    }
+}
+
+static bool same_ast(const AstExpr *a, const AstExpr *b) {
+    if (a->type.id != b->type.id)
+        return false;
+
+    if (AstExpr_is_atom(a))
+        return a->tok_start == b->tok_start && a->tok_len == b->tok_len;
+
+    if (a->rule.id != b->rule.id || a->len != b->len)
+        return false;
+
+    for (size_t i = 0; i < a->len; ++i)
+        if (!same_ast(a->exprs[i], b->exprs[i]))
+            return false;
+
+    return true;
+}
+
+// parses `tb` with `engine`, NULL on failure
+static AstExpr *parse_with(Bump *pool, const File *file, const TokBuf *tb,
+                           ParseEngine engine) {
+    fungus_lang.engine = engine;
+
+    AstExpr *ast = parse(&(AstCtx){
+        .pool = pool,
+        .file = file,
+        .lang = &fungus_lang
+    }, tb);
+
+    if (global_error) {
+        global_error = false;
+        return NULL;
+    }
+
+    return ast;
+}
+
+// returns whether both engines agree on `file`
+static bool check_case(const File *file) {
+    Bump pool = Bump_new();
+    TokBuf tb = lex(&pool, file, &fungus_lang, 0, file->text.len);
+    bool same = true;
+
+    if (global_error) {
+        global_error = false;
+    } else {
+        AstExpr *swept = parse_with(&pool, file, &tb, PARSE_SWEEP);
+        AstExpr *climbed = parse_with(&pool, file, &tb, PARSE_CLIMB);
+
+        same = swept && climbed ? same_ast(swept, climbed) : swept == climbed;
+    }
+
+    TokBuf_del(&tb);
+    Bump_del(&pool);
+
+    return same;
+}
+
+int main(void) {
+    words_init();
+    types_init();
+    names_init();
+    Names names = Names_new();
+    fungus_define_base(&names);
+    pattern_lang_init(&names);
+    fungus_lang_init(&names);
+
+    if (!fungus_lang.climbable) {
+        fprintf(stderr, "climb: fungus_lang can't be climbed\n");
+        return 1;
+    }
+
+    Text text = {0};
+    size_t mismatched = 0;
+
+    for (size_t i = 0; i < NUM_CASES; ++i) {
+        text.len = 0;
+
+        for (size_t lines = 1 + rng(3); lines > 0; --lines) {
+            if (i % 2)
+                gen_soup(&text);
+            else
+                gen_expr(&text, 1 + rng(MAX_DEPTH));
+
+            put(&text, "\n");
+        }
+
+        File file = File_from_str("climb", text.str, text.len);
+
+        if (!check_case(&file)) {
+            fprintf(stderr, "case %zu: engines differ on:\n%.*s", i,
+                    (int)text.len, text.str);
+            ++mismatched;
+        }
+
+        File_del(&file);
+    }
+
+    // one long expr each, every operand nested in the last
+    const char *chains[] = {
+        "a = ", " + b * ", " or !", " == (b - ", " and if a { b } elif ",
+    };
+
+    for (size_t i = 0; i < ARRAY_SIZE(chains); ++i) {
+        text.len = 0;
+
+        for (size_t j = 0; j < CHAIN_TERMS; ++j) {
+            put(&text, "a");
+            put(&text, chains[i]);
+        }
+
+        put(&text, "a\n");
+
+        File file = File_from_str("climb", text.str, text.len);
+
+        if (!check_case(&file)) {
+            fprintf(stderr, "chain `a%sa` differs\n", chains[i]);
+            ++mismatched;
+        }
+
+        File_del(&file);
+    }
+
+    printf("climb: %zu cases, %zu mismatched\n",
+           NUM_CASES + ARRAY_SIZE(chains), mismatched);
+
+    free(text.str);
+    fungus_lang_quit();
+    pattern_lang_quit();
+    Names_del(&names);
+    names_quit();
+    types_quit();
+    words_quit();
+
+    return mismatched ? 1 : 0;
+}
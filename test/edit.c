@@ -0,0 +1,285 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "fungus.h"
+#include "compilation.h"
+#include "lang/ast_expr.h"
+
+/*
+ * random edits against Compilation_apply_edit. after every edit the tokens and
+ * AST must be exactly what compiling the new text from scratch gives, and an
+ * edit must fail exactly when compiling from scratch does. failed edits are
+ * undone by another edit, which has to recover from the failure.
+ */
+
+#define NUM_EDITS 3000
+
+static const char *start_text =
+    "let x = 1 + 2 * 3 - 4 / 2\n"
+    "const y = x == 7\n"
+    "val z = !(x < 3) and y or x >= 2\n"
+    "a = b = 4 % 3\n"
+    "if y { 1 } elif x < 3 { 2 } else { 3 }\n";
+
+static const char *pieces[] = {
+    " ", "x", "1", "2.5", "+", " + ", "{ a }", "\"s\"", "(", ")", "\n",
+    "let y = 2\n", "==", " * 3", "if a { b } else { c }\n", "and", " or ",
+    "-", "`", "`+ ", "=", "\"\\q\"",
+    // these leave a string or curly open somewhere, and usually fail
+    "\"", "{", "}",
+};
+
+/*
+ * fixed edits reaching across the places where relexing and reparsing have to
+ * stop: scope brackets, string literals and the boundaries between top level
+ * exprs. each edit replaces `old_len` chars at the first `at` in the text.
+ */
+typedef struct Edit {
+    const char *at;
+    size_t old_len;
+    const char *piece;
+} Edit;
+
+typedef struct Case {
+    const char *text;
+    Edit edits[5];
+} Case;
+
+static const Case cases[] = {
+    // scope brackets
+    { "let x = 1\nlet y = 2\nlet z = 3\n",
+      {{ "let y", 0, "if x { " }, { "\nlet z", 0, " }" }} },
+    { "if a { b } else { c }\nlet x = 1\n",
+      {{ "} else {", 8, "" }} },
+    { "if a { b + c } else { d }\n",
+      {{ "+ c", 0, "} elif e { " }} },
+    { "if a { b }\nlet x = 1\n",
+      {{ "{ ", 2, "" }, { " }", 2, "" }, { "b", 0, "{ " }, { "\n", 0, " }" }} },
+    // string literals
+    { "let s = \"a { b\"\nlet t = { 1 }\n",
+      {{ "\"a", 1, "" }, { "a", 0, "\"" }} },
+    { "let s = \"a } b\" + \"c\"\n",
+      {{ "} b", 0, "\" + \"" }} },
+    { "let s = \"a\\\"b\"\nlet t = 2\n",
+      {{ "\\", 1, "" }, { "\"b", 0, "\\" }} },
+    { "let s = \"{\"\nif a { b }\n",
+      {{ "{\"", 0, "}" }, { "if", 0, "\"" }, { "\"if", 1, "" }} },
+    // top level expr boundaries
+    { "let x = 1 + 2\nlet y = x * 3\n",
+      {{ "\nlet y", 1, " " }, { " let y", 1, "\n" }} },
+    { "let x = 1 + 2 * 3\n",
+      {{ "+ 2", 0, "\n" }} },
+    { "a = 1\nb = 2\n",
+      {{ "\nb", 1, " + " }} },
+    { "x\ny\n",
+      {{ "\ny", 1, "" }, { "xy", 1, "x " }} },
+    { "let x = 1 +\n2\n",
+      {{ "+", 0, "`" }, { "\n2", 1, " " }} },
+    { "let x = 1\n",
+      {{ "let", 0, "x = 2\n" }, { "1\n", 2, "1 + 3\n" }} },
+    // far apart edits move the token gap both ways
+    { "let x = 1 + 2 * 3 - 4 / 2\n"
+      "const y = x == 7\n"
+      "val z = !(x < 3) and y or x >= 2\n"
+      "a = b = 4 % 3\n"
+      "if y { 1 } elif x < 3 { 2 } else { 3 }\n",
+      {{ "3 }\n", 0, "1 + " }, { "let x", 5, "let q" }, { "a = b", 1, "c" },
+       { "x >= 2", 0, "y + " }, { "7", 1, "{ 7 }" }} },
+};
+
+// offset of the first `str` in the file
+static size_t find(const File *file, const char *str) {
+    size_t len = strlen(str);
+
+    for (size_t i = 0; i + len <= file->text.len; ++i)
+        if (!memcmp(&file->text.str[i], str, len))
+            return i;
+
+    fungus_panic("edit case has no `%s`\n", str);
+}
+
+static uint64_t rng_state = 0x9e3779b97f4a7c15;
+
+static size_t rng(size_t n) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+
+    return rng_state % n;
+}
+
+// the parser can't handle an escape that isn't followed by a symbol or word
+static bool escapes_ok(const char *str, size_t len) {
+    for (size_t i = 0; i < len; ++i) {
+        if (str[i] == '`'
+         && (i + 1 == len || strchr(" \n{\"`", str[i + 1])))
+            return false;
+    }
+
+    return true;
+}
+
+static bool same_ast(const AstExpr *a, const AstExpr *b) {
+    if (a->type.id != b->type.id)
+        return false;
+
+    if (AstExpr_is_atom(a))
+        return a->tok_start == b->tok_start && a->tok_len == b->tok_len;
+
+    if (a->rule.id != b->rule.id || a->len != b->len)
+        return false;
+
+    for (size_t i = 0; i < a->len; ++i)
+        if (!same_ast(a->exprs[i], b->exprs[i]))
+            return false;
+
+    return true;
+}
+
+// returns whether `c` matches a compilation of its text from scratch
+static bool check_edit(Compilation *c, bool success) {
+    Compilation full = Compilation_new(File_from_str("full", c->file.text.str,
+                                                     c->file.text.len),
+                                       c->lang);
+    bool full_success = full.ast != NULL;
+    bool same = success == full_success;
+
+    if (same && success) {
+        TokBuf full_toks = Compilation_toks(&full);
+        TokBuf toks = Compilation_toks(c);
+
+        same = full_toks.len == toks.len;
+
+        for (size_t i = 0; same && i < toks.len; ++i) {
+            same = full_toks.types[i] == toks.types[i]
+                && full_toks.starts[i] == toks.starts[i]
+                && full_toks.lens[i] == toks.lens[i];
+        }
+
+        same = same && same_ast(full.ast, Compilation_ast(c));
+    }
+
+    Compilation_del(&full);
+
+    return same;
+}
+
+// returns the number of mismatched edits
+static size_t run_case(size_t index) {
+    const Case *cs = &cases[index];
+    Compilation c = Compilation_new(File_from_str("case", cs->text,
+                                                  strlen(cs->text)),
+                                    &fungus_lang);
+    size_t mismatched = 0;
+
+    for (size_t i = 0; i < ARRAY_SIZE(cs->edits) && cs->edits[i].at; ++i) {
+        const Edit *e = &cs->edits[i];
+        size_t start = find(&c.file, e->at);
+        bool success = Compilation_apply_edit(&c, start, e->old_len, e->piece,
+                                              strlen(e->piece));
+
+        if (!check_edit(&c, success)) {
+            fprintf(stderr, "case %zu: edit %zu differs from a full rebuild\n",
+                    index, i);
+            ++mismatched;
+        }
+    }
+
+    Compilation_del(&c);
+
+    return mismatched;
+}
+
+int main(void) {
+    words_init();
+    types_init();
+    names_init();
+    Names names = Names_new();
+    fungus_define_base(&names);
+    pattern_lang_init(&names);
+    fungus_lang_init(&names);
+
+    size_t case_mismatched = 0;
+
+    for (size_t i = 0; i < ARRAY_SIZE(cases); ++i)
+        case_mismatched += run_case(i);
+
+    printf("edit: %zu cases, %zu mismatched\n", ARRAY_SIZE(cases),
+           case_mismatched);
+
+    Compilation c = Compilation_new(File_from_str("edit", start_text,
+                                                  strlen(start_text)),
+                                    &fungus_lang);
+    size_t edits = 0, failed = 0, mismatched = 0;
+
+    for (size_t i = 0; i < NUM_EDITS; ++i) {
+        size_t text_len = c.file.text.len;
+        size_t start = rng(text_len + 1);
+        size_t old_len = rng(4) ? 0 : rng(6);
+        const char *piece = rng(3) ? pieces[rng(ARRAY_SIZE(pieces))] : "";
+        size_t len = strlen(piece);
+
+        if (start + old_len > text_len)
+            old_len = text_len - start;
+
+        if (!old_len && !len)
+            continue;
+
+        // check the edited text before applying it
+        size_t new_len = text_len - old_len + len;
+        char *text = malloc(new_len);
+
+        memcpy(text, c.file.text.str, start);
+        memcpy(&text[start], piece, len);
+        memcpy(&text[start + len], &c.file.text.str[start + old_len],
+               text_len - start - old_len);
+
+        bool ok = escapes_ok(text, new_len);
+
+        free(text);
+
+        if (!ok)
+            continue;
+
+        char old_text[8];
+
+        memcpy(old_text, &c.file.text.str[start], old_len);
+
+        bool success = Compilation_apply_edit(&c, start, old_len, piece, len);
+
+        ++edits;
+
+        if (!success)
+            ++failed;
+
+        if (!check_edit(&c, success)) {
+            fprintf(stderr, "edit %zu: replacing %zu chars at %zu with `%s` "
+                    "differs from a full rebuild\n", i, old_len, start, piece);
+            ++mismatched;
+        }
+
+        if (!success) {
+            success = Compilation_apply_edit(&c, start, len, old_text,
+                                             old_len);
+
+            if (!check_edit(&c, success)) {
+                fprintf(stderr, "edit %zu: undoing it differs from a full "
+                        "rebuild\n", i);
+                ++mismatched;
+            }
+        }
+    }
+
+    printf("edit: %zu edits, %zu failed, %zu mismatched\n", edits, failed,
+           mismatched);
+
+    Compilation_del(&c);
+    fungus_lang_quit();
+    pattern_lang_quit();
+    Names_del(&names);
+    names_quit();
+    types_quit();
+    words_quit();
+
+    return mismatched || case_mismatched ? 1 : 0;
+}
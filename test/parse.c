@@ -0,0 +1,280 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "fungus.h"
+#include "lex.h"
+#include "parse.h"
+#include "lang/ast_expr.h"
+
+/*
+ * parses fixed fungus sources and checks each AST against the one the
+ * original parse_scope built for it, before it memoized matches, collapsed in
+ * a gap buffer and skipped precs by key. the sources cover nested scopes,
+ * optional and repeating operands (if chains), prefix operators, parens,
+ * right associative assignment and every binary prec.
+ *
+ * the expected ASTs keep that sweep's quirks. for example `!(x < 3)` doesn't
+ * form a Not, because Parens is a Default rule and is formed last.
+ *
+ * lead_cases are parsed with a small lang whose Tag rules lead with up to two
+ * optional exprs before their key lexeme, so the sweep has to find matches
+ * starting anywhere from `lead` exprs before a key up to the key itself.
+ *
+ * ASTs are written as `(Rule child ...)`, with atoms as their source text.
+ * raw scopes are lexed and parsed in place, and written as the scope they
+ * parse to. both engines must give the expected AST.
+ */
+
+typedef struct Case {
+    const char *src, *ast;
+} Case;
+
+static const Case cases[] = {
+    {
+        "let x = 1 + 2 * 3 - 4 / 2 % 5",
+        "(Scope (LetDecl let x = (Subtract (Add 1 + (Multiply 2 * 3)) - "
+        "(Modulo (Divide 4 / 2) % 5))))"
+    },
+    {
+        "a = b = c + d * e",
+        "(Scope (Assign a = (Assign b = (Add c + (Multiply d * e)))))"
+    },
+    {
+        "val z = !(x < 3) and y or x >= 2 == !b",
+        "(Scope val z = ! (Parens ( (LessThan x < 3) )) and (Or y or (Equals "
+        "(GreaterThanOrEquals x >= 2) == (Not ! b))))"
+    },
+    {
+        "const c = a != b and c <= d or e > f and !!g",
+        "(Scope (ConstDecl const c = (Or (And (NotEquals a != b) and "
+        "(LessThanOrEquals c <= d)) or (And (GreaterThan e > f) and (Not ! "
+        "(Not ! g))))))"
+    },
+    {
+        "if a { b }",
+        "(Scope (IfChain (If if a (Scope b))))"
+    },
+    {
+        "if a { b } else { c }",
+        "(Scope (IfChain (If if a (Scope b))) (Else else (Scope c)))"
+    },
+    {
+        "if a { b } elif c { d } elif e { f } else { g }",
+        "(Scope (IfChain (If if a (Scope b))) (Elif elif c (Scope d)) (Elif "
+        "elif e (Scope f)) (Else else (Scope g)))"
+    },
+    {
+        "if a { b } elif c { d } x = 1",
+        "(Scope (IfChain (If if a (Scope b))) (Elif elif c (Scope d)) (Assign "
+        "x = 1))"
+    },
+    {
+        "if a == 1 { if b { c = 1 } else { c = 2 } } elif !d { { e } }",
+        "(Scope (IfChain (If if (Equals a == 1) (Scope (IfChain (If if b "
+        "(Scope (Assign c = 1)))) (Else else (Scope (Assign c = 2)))))) (Elif "
+        "elif (Not ! d) (Scope (Scope e))))"
+    },
+    {
+        "let f = { let q = (1 + 2) * 3 q - 1 } const g = 2",
+        "(Scope (LetDecl let f = (Scope let q = (Parens ( (Add 1 + 2) )) * 3 "
+        "(Subtract q - 1))) (ConstDecl const g = 2))"
+    },
+    {
+        "x = ((a + b) * (c - d)) / -e",
+        "(Scope x = ( (Parens ( (Add a + b) )) * (Parens ( (Subtract c - d) )) "
+        ") / - e)"
+    },
+    {
+        "else { a } elif b { c } if",
+        "(Scope (Else else (Scope a)) (Elif elif b (Scope c)) if)"
+    },
+    {
+        "a = if b { c } else { d = e = f }",
+        "(Scope a = (IfChain (If if b (Scope c))) (Else else (Scope (Assign d "
+        "= (Assign e = f)))))"
+    },
+    {
+        "1 + 2.5 * c - true / `+ + a",
+        "(Scope (Add (Subtract (Add 1 + (Multiply 2.5 * c)) - (Divide true / "
+        "+)) + a))"
+    },
+};
+
+// precs from lowest to highest, all left associative
+static const char *lead_precs[] = { "Default", "Tag", "Sum" };
+
+static const struct {
+    const char *name, *prec, *pat;
+} lead_rules[] = {
+    { "Tag2", "Tag",
+      "a: AnyExpr!T? b: AnyExpr!T? `~ c: AnyExpr!T -> T where T = AnyValue" },
+    { "Tag1", "Tag", "a: AnyExpr!T? `% b: AnyExpr!T -> T where T = AnyValue" },
+    { "Sum", "Sum",
+      "lhs: AnyExpr!T `+ rhs: AnyExpr!T -> T where T = AnyValue" },
+};
+
+static const Case lead_cases[] = {
+    { "~ c", "(Scope (Tag2 ~ c))" },
+    { "b ~ c", "(Scope (Tag2 b ~ c))" },
+    { "a b ~ c", "(Scope (Tag2 a b ~ c))" },
+    { "x a b ~ c", "(Scope x (Tag2 a b ~ c))" },
+    { "a + b c + d ~ e", "(Scope (Tag2 (Sum a + b) (Sum c + d) ~ e))" },
+    { "a b ~ c d e f g ~ h", "(Scope (Tag2 a b ~ c) d e (Tag2 f g ~ h))" },
+    { "a % b ~ c", "(Scope (Tag2 (Tag1 a % b) ~ c))" },
+    { "~ a ~ b b % c", "(Scope (Tag2 (Tag2 ~ a) ~ b) (Tag1 b % c))" },
+};
+
+typedef struct Text {
+    char *str;
+    size_t len, cap;
+} Text;
+
+static void put(Text *t, const char *str, size_t len) {
+    if (t->len + len + 1 > t->cap) {
+        t->cap = (t->len + len + 1) * 2;
+        t->str = realloc(t->str, t->cap);
+    }
+
+    memcpy(&t->str[t->len], str, len);
+    t->len += len;
+    t->str[t->len] = '\0';
+}
+
+static void dump_scope(Text *t, Bump *pool, const Lang *lang,
+                       const File *file, size_t start, size_t len);
+
+static void dump(Text *t, Bump *pool, const Lang *lang, const File *file,
+                 const AstExpr *expr) {
+    if (expr->type.id == ID_SCOPE && AstExpr_is_atom(expr)) {
+        // drop the curlies
+        dump_scope(t, pool, lang, file, expr->tok_start + 1,
+                   expr->tok_len - 2);
+    } else if (AstExpr_is_atom(expr)) {
+        put(t, &file->text.str[expr->tok_start], expr->tok_len);
+    } else {
+        const Word *name = Type_name(expr->type);
+
+        put(t, "(", 1);
+        put(t, name->str, name->len);
+
+        for (size_t i = 0; i < expr->len; ++i) {
+            put(t, " ", 1);
+            dump(t, pool, lang, file, expr->exprs[i]);
+        }
+
+        put(t, ")", 1);
+    }
+}
+
+static void dump_scope(Text *t, Bump *pool, const Lang *lang,
+                       const File *file, size_t start, size_t len) {
+    TokBuf tb = lex(pool, file, lang, start, len);
+
+    if (!global_error) {
+        AstExpr *ast = parse(&(AstCtx){
+            .pool = pool,
+            .file = file,
+            .lang = lang
+        }, &tb);
+
+        if (ast)
+            dump(t, pool, lang, file, ast);
+    }
+
+    if (global_error) {
+        put(t, "<error>", 7);
+        global_error = false;
+    }
+
+    TokBuf_del(&tb);
+}
+
+// returns whether `c` parses to c->ast with `lang`'s engine
+static bool check_case(const Case *c, const Lang *lang, const char *name) {
+    File file = File_from_str("parse", c->src, strlen(c->src));
+    Bump pool = Bump_new();
+    Text t = {0};
+
+    dump_scope(&t, &pool, lang, &file, 0, file.text.len);
+
+    bool same = !strcmp(t.str, c->ast);
+
+    if (!same) {
+        fprintf(stderr, "%s parsed `%s` as:\n  %s\nexpected:\n  %s\n", name,
+                c->src, t.str, c->ast);
+    }
+
+    free(t.str);
+    Bump_del(&pool);
+    File_del(&file);
+
+    return same;
+}
+
+static Lang lead_lang_new(Names *names, File *files) {
+    Lang lang = Lang_new(WORD("Lead"));
+
+    for (size_t i = 0; i < ARRAY_SIZE(lead_precs); ++i)
+        Lang_make_prec(&lang, WORD(lead_precs[i]), ASSOC_LEFT);
+
+    for (size_t i = 0; i < ARRAY_SIZE(lead_rules); ++i) {
+        Type type = Type_define(names, WORD(lead_rules[i].name), &fun_rule, 1);
+        Word prec_name = WORD(lead_rules[i].prec);
+        Prec prec = Prec_by_name(&lang.precs, &prec_name);
+
+        files[i] = pattern_file(lead_rules[i].pat);
+
+        AstExpr *pat = precompile_pattern(&lang.rules.pool, names, &files[i]);
+
+        Lang_legislate(&lang, &files[i], type, prec, pat);
+    }
+
+    Lang_crystallize(&lang, names);
+
+    return lang;
+}
+
+int main(void) {
+    words_init();
+    types_init();
+    names_init();
+    Names names = Names_new();
+    fungus_define_base(&names);
+    pattern_lang_init(&names);
+    fungus_lang_init(&names);
+
+    size_t mismatched = 0;
+
+    for (size_t i = 0; i < ARRAY_SIZE(cases); ++i) {
+        fungus_lang.engine = PARSE_SWEEP;
+        mismatched += !check_case(&cases[i], &fungus_lang, "sweep");
+        fungus_lang.engine = PARSE_CLIMB;
+        mismatched += !check_case(&cases[i], &fungus_lang, "climb");
+    }
+
+    fungus_lang.engine = PARSE_SWEEP;
+
+    // optional leads can't be climbed, so this is sweep only
+    File lead_files[ARRAY_SIZE(lead_rules)];
+    Lang lead_lang = lead_lang_new(&names, lead_files);
+
+    for (size_t i = 0; i < ARRAY_SIZE(lead_cases); ++i)
+        mismatched += !check_case(&lead_cases[i], &lead_lang, "sweep");
+
+    printf("parse: %zu cases, %zu mismatched\n",
+           ARRAY_SIZE(cases) + ARRAY_SIZE(lead_cases), mismatched);
+
+    Lang_del(&lead_lang);
+
+    for (size_t i = 0; i < ARRAY_SIZE(lead_files); ++i)
+        File_del(&lead_files[i]);
+
+    fungus_lang_quit();
+    pattern_lang_quit();
+    Names_del(&names);
+    names_quit();
+    types_quit();
+    words_quit();
+
+    return mismatched ? 1 : 0;
+}